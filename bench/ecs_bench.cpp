@@ -0,0 +1,555 @@
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../src/components/rigidbody_component.hpp"
+#include "../src/components/sprite_component.hpp"
+#include "../src/components/transform_component.hpp"
+#include "../src/ecs/ecs.hpp"
+#include "../src/systems/movement_system.hpp"
+
+using debby::MovementSystem;
+using debby::RigidBodyComponent;
+using debby::SpriteComponent;
+using debby::TransformComponent;
+
+/* Operations each measurement aims to cover, such that small entity
+ * counts are repeated enough for the timings to be stable */
+constexpr std::size_t TARGET_OPS{2000000};
+
+/* Bounds on the number of timed repetitions of each benchmark */
+constexpr std::size_t MIN_REPEATS{3};
+constexpr std::size_t MAX_REPEATS{50};
+
+/* Keeps the compiler from optimizing the iteration away */
+static volatile float sink{};
+
+/* Storage of every registry the benchmarks create, run once per
+ * storage to compare the per-type pools against archetypes */
+static debby::ecs::Storage storage{debby::ecs::Storage::pools};
+
+/* Every allocation made through operator new, such that benchmarks
+ * can report how much memory their operations allocate */
+static std::atomic<std::size_t> allocated_bytes{0};
+static std::atomic<std::size_t> allocation_count{0};
+
+static void *counted_alloc(std::size_t size, std::size_t alignment) {
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size = std::max<std::size_t>(size, 1);
+    void *ptr{nullptr};
+    if (alignment <= alignof(std::max_align_t)) {
+        ptr = std::malloc(size);
+    } else {
+#ifdef _MSC_VER
+        ptr = _aligned_malloc(size, alignment);
+#else
+        /* aligned_alloc wants the size to be a multiple of alignment */
+        ptr = std::aligned_alloc(
+            alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+static void counted_free(void *ptr, std::size_t alignment) {
+#ifdef _MSC_VER
+    if (alignment > alignof(std::max_align_t)) {
+        _aligned_free(ptr);
+        return;
+    }
+#endif
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *ptr) noexcept {
+    counted_free(ptr, alignof(std::max_align_t));
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    counted_free(ptr, alignof(std::max_align_t));
+}
+
+void operator delete(void *ptr, std::align_val_t alignment) noexcept {
+    counted_free(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *ptr, std::size_t,
+                     std::align_val_t alignment) noexcept {
+    counted_free(ptr, static_cast<std::size_t>(alignment));
+}
+
+/* System that only declares which components it requires,
+ * used to give the registry memberships to maintain */
+template <typename... TComponents>
+class RequiresSystem : public debby::ecs::System {
+   public:
+    RequiresSystem() {
+        (require_component<TComponents>(debby::ecs::Access::read), ...);
+    }
+};
+
+/* Has the same signature as the RenderSystem */
+using RenderableSystem = RequiresSystem<TransformComponent, SpriteComponent>;
+
+struct Result {
+    std::string name;
+    std::size_t entities;
+    double ns_per_op;
+    double bytes_per_op;
+    double allocations_per_op;
+};
+
+enum class Format { table, csv, json };
+
+/*
+ * Runs prepare and then times run, repeatedly, where run performs ops
+ * operations. Only run is timed and has its allocations counted, such
+ * that prepare can restore whatever state run consumes */
+static Result measure(const char *name, std::size_t entities,
+                      std::size_t ops, const std::function<void()> &prepare,
+                      const std::function<void()> &run) {
+    const std::size_t repeats{std::clamp(
+        TARGET_OPS / std::max<std::size_t>(ops, 1), MIN_REPEATS, MAX_REPEATS)};
+    /* warm up, such that first-time growth is not measured */
+    prepare();
+    run();
+    std::chrono::duration<double, std::nano> elapsed{0};
+    std::size_t bytes{0};
+    std::size_t allocations{0};
+    for (std::size_t i = 0; i < repeats; i++) {
+        prepare();
+        const std::size_t bytes_before{allocated_bytes.load()};
+        const std::size_t allocations_before{allocation_count.load()};
+        const auto start{std::chrono::steady_clock::now()};
+        run();
+        elapsed += std::chrono::steady_clock::now() - start;
+        bytes += allocated_bytes.load() - bytes_before;
+        allocations += allocation_count.load() - allocations_before;
+    }
+    const auto total_ops{static_cast<double>(repeats * ops)};
+    return {name, entities, elapsed.count() / total_ops,
+            static_cast<double>(bytes) / total_ops,
+            static_cast<double>(allocations) / total_ops};
+}
+
+static void nothing() {}
+
+/* Throughput, e.g. entities moved per millisecond */
+static double get_ops_per_ms(const Result &result) {
+    return result.ns_per_op > 0 ? 1e6 / result.ns_per_op : 0;
+}
+
+/* Creates count renderable entities, interleaved with entities that
+ * only have a transform, and then destroys and recreates a part of
+ * them such that the pools are no longer in the same order */
+static void populate(debby::ecs::Registry &registry, std::size_t count) {
+    std::vector<debby::ecs::Entity> entities{};
+    for (std::size_t i = 0; i < count; i++) {
+        auto entity{registry.create_entity()};
+        entity.add_component<TransformComponent>(
+            glm::vec2{static_cast<float>(i), 0.f});
+        if (i % 4 != 0) {
+            entity.add_component<SpriteComponent>(
+                "bench", 32, 32, static_cast<int>(i % 3));
+        }
+        if (i % 2 == 0) {
+            entity.add_component<RigidBodyComponent>(glm::vec2{1.f, 0.f});
+        }
+        entities.push_back(entity);
+    }
+    registry.update();
+    for (std::size_t i = 0; i < count; i += 3) {
+        entities[i].kill();
+    }
+    registry.update();
+    for (std::size_t i = 0; i < count; i += 3) {
+        auto entity{registry.create_entity()};
+        entity.add_component<SpriteComponent>("bench", 32, 32, 1);
+        entity.add_component<TransformComponent>();
+    }
+    registry.update();
+}
+
+/* Creating entities with a component and destroying them again */
+static void bench_churn(std::vector<Result> &results, std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    registry.add_system<RequiresSystem<TransformComponent>>();
+    std::vector<debby::ecs::Entity> entities{};
+    entities.reserve(count);
+    results.push_back(measure("churn", count, count, nothing, [&] {
+        for (std::size_t i = 0; i < count; i++) {
+            auto entity{registry.create_entity()};
+            entity.add_component<TransformComponent>();
+            entities.push_back(entity);
+        }
+        registry.update();
+        for (auto &entity : entities) {
+            entity.kill();
+        }
+        registry.update();
+        entities.clear();
+    }));
+}
+
+/* Adding a component to every entity and removing it again, without
+ * the update that processes the resulting signature changes */
+static void bench_add_remove(std::vector<Result> &results,
+                             std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    const auto entities{registry.create_entities(count)};
+    registry.update();
+    results.push_back(measure(
+        "add_remove", count, count * 2, [&registry] { registry.update(); },
+        [&] {
+            for (auto entity : entities) {
+                entity.add_component<RigidBodyComponent>();
+            }
+            for (auto entity : entities) {
+                entity.remove_component<RigidBodyComponent>();
+            }
+        }));
+}
+
+/* An update processing count spawned entities, and then
+ * one processing count destroyed entities */
+static void bench_update_queues(std::vector<Result> &results,
+                                std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    registry.add_system<RenderableSystem>();
+    std::vector<debby::ecs::Entity> entities{};
+    entities.reserve(count);
+    const auto spawn{[&] {
+        entities.clear();
+        for (std::size_t i = 0; i < count; i++) {
+            auto entity{registry.create_entity()};
+            entity.add_component<TransformComponent>();
+            entity.add_component<SpriteComponent>("bench", 32, 32, 0);
+            entities.push_back(entity);
+        }
+    }};
+    const auto despawn{[&] {
+        for (auto &entity : entities) {
+            entity.kill();
+        }
+    }};
+    const auto update{[&registry] { registry.update(); }};
+    const auto prepare_spawned{[&] {
+        registry.clear();
+        spawn();
+    }};
+    const auto prepare_destroyed{[&] {
+        registry.clear();
+        spawn();
+        registry.update();
+        despawn();
+    }};
+    results.push_back(
+        measure("update_spawned", count, count, prepare_spawned, update));
+    results.push_back(
+        measure("update_destroyed", count, count, prepare_destroyed, update));
+}
+
+/* Spawning entities from a prefab, including the update that adds
+ * them to systems */
+static void bench_instantiate(std::vector<Result> &results,
+                              std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    registry.add_system<RenderableSystem>();
+    registry.add_system<
+        RequiresSystem<TransformComponent, RigidBodyComponent>>();
+    debby::ecs::Prefab prefab{};
+    prefab.add_component<TransformComponent>(glm::vec2{1.f, 2.f});
+    prefab.add_component<RigidBodyComponent>(glm::vec2{1.f, 0.f});
+    prefab.add_component<SpriteComponent>("bench", 32, 32, 1);
+    results.push_back(measure(
+        "instantiate", count, count, [&registry] { registry.clear(); },
+        [&] {
+            registry.instantiate(prefab, count);
+            registry.update();
+        }));
+}
+
+/* Writing a world to memory and restoring it, with one system and
+ * one group for restore to hand the entities back to */
+static void bench_snapshot(std::vector<Result> &results,
+                           std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    registry.add_system<RenderableSystem>();
+    registry.group<TransformComponent, RigidBodyComponent>();
+    populate(registry, count);
+    const std::size_t entities{
+        registry.get_pool<TransformComponent>()->get_size()};
+    debby::ecs::MemoryWriter snapshot{};
+    const auto write{[&] {
+        snapshot = debby::ecs::MemoryWriter{};
+        if (!registry.snapshot(snapshot)) {
+            std::abort();
+        }
+    }};
+    results.push_back(measure("snapshot_write", entities, entities, nothing,
+                              write));
+    const auto restore{[&] {
+        debby::ecs::MemoryReader reader{snapshot.get_bytes()};
+        if (!registry.restore(reader)) {
+            std::abort();
+        }
+    }};
+    results.push_back(measure("snapshot_restore", entities, entities,
+                              nothing, restore));
+}
+
+/* An update moving every entity in and out of several systems */
+static void bench_membership(std::vector<Result> &results,
+                             std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    registry.add_system<RequiresSystem<TransformComponent>>();
+    registry.add_system<RequiresSystem<RigidBodyComponent>>();
+    registry.add_system<RenderableSystem>();
+    registry.add_system<
+        RequiresSystem<TransformComponent, RigidBodyComponent>>();
+    registry.add_system<RequiresSystem<TransformComponent, RigidBodyComponent,
+                                       SpriteComponent>>();
+    populate(registry, count);
+    const std::vector<debby::ecs::Entity> entities{
+        registry.get_system<RequiresSystem<TransformComponent>>()
+            .get_entities()};
+    bool has_body{false};
+    const auto toggle_body{[&] {
+        for (auto entity : entities) {
+            if (has_body) {
+                entity.remove_component<RigidBodyComponent>();
+            } else {
+                entity.add_component<RigidBodyComponent>();
+            }
+        }
+        has_body = !has_body;
+    }};
+    results.push_back(measure("membership", entities.size(), entities.size(),
+                              toggle_body,
+                              [&registry] { registry.update(); }));
+}
+
+/* Iterating one component, and two components through each of the
+ * ways the engine offers: system entities, queries, views and groups */
+static void bench_iteration(std::vector<Result> &results,
+                            std::size_t count) {
+    debby::ecs::Registry registry{storage};
+    registry.add_system<RenderableSystem>();
+    populate(registry, count);
+    const auto &system{registry.get_system<RenderableSystem>()};
+    auto &group{registry.group<TransformComponent, SpriteComponent>()};
+
+    const auto single{[&registry] {
+        float sum{0};
+        registry.view<TransformComponent>().each(
+            [&sum](debby::ecs::Entity, const TransformComponent &transform) {
+                sum += transform.position.x;
+            });
+        sink = sum;
+    }};
+    const auto through_system{[&system] {
+        float sum{0};
+        for (auto entity : system.get_entities()) {
+            const auto &transform{entity.get_component<TransformComponent>()};
+            const auto &sprite{entity.get_component<SpriteComponent>()};
+            sum += transform.position.x + static_cast<float>(sprite.z_index);
+        }
+        sink = sum;
+    }};
+    const auto through_view{[&registry] {
+        float sum{0};
+        registry.view<TransformComponent, SpriteComponent>().each(
+            [&sum](debby::ecs::Entity, const TransformComponent &transform,
+                   const SpriteComponent &sprite) {
+                sum +=
+                    transform.position.x + static_cast<float>(sprite.z_index);
+            });
+        sink = sum;
+    }};
+    const auto query{registry.query<TransformComponent, SpriteComponent>()};
+    const auto through_query{[&query] {
+        float sum{0};
+        for (auto entity : query) {
+            const auto &transform{entity.get_component<TransformComponent>()};
+            const auto &sprite{entity.get_component<SpriteComponent>()};
+            sum += transform.position.x + static_cast<float>(sprite.z_index);
+        }
+        sink = sum;
+    }};
+    const auto through_group{[&group] {
+        float sum{0};
+        group.each([&sum](debby::ecs::Entity,
+                          const TransformComponent &transform,
+                          const SpriteComponent &sprite) {
+            sum += transform.position.x + static_cast<float>(sprite.z_index);
+        });
+        sink = sum;
+    }};
+
+    std::size_t transforms{0};
+    registry.view<TransformComponent>().each(
+        [&transforms](debby::ecs::Entity, const TransformComponent &) {
+            transforms++;
+        });
+    const std::size_t matching{system.get_entities().size()};
+    results.push_back(
+        measure("iterate_single", transforms, transforms, nothing, single));
+    results.push_back(measure("iterate_system", matching, matching, nothing,
+                              through_system));
+    results.push_back(measure("iterate_query", matching, matching, nothing,
+                              through_query));
+    results.push_back(
+        measure("iterate_view", matching, matching, nothing, through_view));
+    results.push_back(
+        measure("iterate_group", matching, matching, nothing, through_group));
+}
+
+/* Integrating every mover once through the movement system */
+static void bench_movement(std::vector<Result> &results, std::size_t count) {
+    constexpr float delta_time{1.f / 60.f};
+    debby::ecs::Registry registry{storage};
+    registry.set_resource<debby::GameContext>().delta_time = delta_time;
+    registry.add_system<MovementSystem>();
+    for (std::size_t i = 0; i < count; i++) {
+        auto entity{registry.create_entity()};
+        entity.add_component<TransformComponent>(
+            glm::vec2{static_cast<float>(i), 0.f});
+        entity.add_component<RigidBodyComponent>(
+            glm::vec2{1.f, static_cast<float>(i % 7)});
+    }
+    registry.update();
+    auto &system{registry.get_system<MovementSystem>()};
+    results.push_back(measure("move", count, count, nothing,
+                              [&system] { system.update(delta_time); }));
+}
+
+static void print(const std::vector<Result> &results, Format format) {
+    if (format == Format::csv) {
+        std::printf("benchmark,entities,ns_per_op,ops_per_ms,bytes_per_op,"
+                    "allocations_per_op\n");
+        for (const auto &result : results) {
+            std::printf("%s,%zu,%.3f,%.1f,%.3f,%.3f\n", result.name.c_str(),
+                        result.entities, result.ns_per_op,
+                        get_ops_per_ms(result), result.bytes_per_op,
+                        result.allocations_per_op);
+        }
+    } else if (format == Format::json) {
+        std::printf("[\n");
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const auto &result{results[i]};
+            std::printf("  {\"benchmark\": \"%s\", \"entities\": %zu, "
+                        "\"ns_per_op\": %.3f, \"ops_per_ms\": %.1f, "
+                        "\"bytes_per_op\": %.3f, "
+                        "\"allocations_per_op\": %.3f}%s\n",
+                        result.name.c_str(), result.entities,
+                        result.ns_per_op, get_ops_per_ms(result),
+                        result.bytes_per_op, result.allocations_per_op,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("]\n");
+    } else {
+        std::printf("%-18s %9s %12s %12s %12s %12s\n", "benchmark",
+                    "entities", "ns/op", "ops/ms", "bytes/op", "allocs/op");
+        for (const auto &result : results) {
+            std::printf("%-18s %9zu %12.2f %12.0f %12.2f %12.4f\n",
+                        result.name.c_str(), result.entities,
+                        result.ns_per_op, get_ops_per_ms(result),
+                        result.bytes_per_op, result.allocations_per_op);
+        }
+    }
+}
+
+static void print_usage(const char *program) {
+    std::fprintf(stderr,
+                 "usage: %s [--format table|csv|json] [--max-entities N] "
+                 "[--filter NAME] [--storage pools|archetypes]\n",
+                 program);
+}
+
+int main(int argc, char *argv[]) {
+    spdlog::set_level(spdlog::level::off);
+    Format format{Format::table};
+    std::size_t max_entities{1000000};
+    std::string filter{};
+    for (int i = 1; i < argc; i++) {
+        const bool has_value{i + 1 < argc};
+        if (std::strcmp(argv[i], "--format") == 0 && has_value) {
+            const std::string value{argv[++i]};
+            if (value == "csv") {
+                format = Format::csv;
+            } else if (value == "json") {
+                format = Format::json;
+            } else if (value != "table") {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--max-entities") == 0 &&
+                   has_value) {
+            max_entities = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--storage") == 0 && has_value) {
+            const std::string value{argv[++i]};
+            if (value == "archetypes") {
+                storage = debby::ecs::Storage::archetypes;
+            } else if (value != "pools") {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    using Bench = void (*)(std::vector<Result> &, std::size_t);
+    const std::pair<const char *, Bench> benches[]{
+        {"churn", bench_churn},
+        {"add_remove", bench_add_remove},
+        {"update", bench_update_queues},
+        {"instantiate", bench_instantiate},
+        {"membership", bench_membership},
+        {"snapshot", bench_snapshot},
+        {"iterate", bench_iteration},
+        {"move", bench_movement},
+    };
+    std::vector<Result> results{};
+    for (const std::size_t count : {1000, 10000, 100000, 1000000}) {
+        if (count > max_entities) {
+            break;
+        }
+        for (const auto &bench : benches) {
+            /* snapshots require pool storage */
+            if (storage != debby::ecs::Storage::pools &&
+                bench.second == bench_snapshot) {
+                continue;
+            }
+            if (filter.empty() || filter == bench.first) {
+                bench.second(results, count);
+            }
+        }
+    }
+    print(results, format);
+    return EXIT_SUCCESS;
+}
@@ -3,12 +3,21 @@
 
 #include <SDL2/SDL_pixels.h>
 
+#include <cstddef>
+#include <cstdint>
+
 namespace debby {
 
-/* contains game-specific information and configuration */
+/* contains game-specific information and configuration, kept
+ * as a registry resource such that systems can read it */
 struct GameContext {
+    /* seconds since the previous frame, clamped to MAXIMUM_DT */
     float delta_time;
+    /* SDL ticks in ms, sampled once at the start of each frame */
+    std::uint32_t ticks;
     bool draw_collision_rects;
+    bool do_cap_frame_rate;
+    bool is_running;
 };
 
 /* simple alias for SDL_Color */
@@ -25,6 +34,9 @@ constexpr int FRAME_TARGET{1000 / FPS};
 /* maximum delta time (useful if running in debugger) */
 constexpr float MAXIMUM_DT{0.05f};
 
+/* entities per job when a system splits its work across threads */
+constexpr std::size_t JOB_CHUNK_SIZE{1024};
+
 /* used to produce epsilon relative
  * to value of some given operands */
 constexpr float REL_EPSILON{1e-8f};
@@ -4,10 +4,14 @@
 #include <SDL2/SDL_timer.h>
 #include <spdlog/spdlog.h>
 
+#include <cstdint>
 #include <map>
 #include <string>
 #include <utility>
 
+#include "../ecs/snapshot.hpp"
+#include "../ecs/types.hpp"
+
 namespace debby {
 
 /* AnimationContext contains information
@@ -78,7 +82,50 @@ class AnimationComponent {
     inline void set_active_animation(const std::string &name) {
         _active_animation = name;
     }
+
+    /* Animations are written to snapshots as a count followed
+     * by each name and context, contexts being plain data */
+    friend bool debby_ecs_write(ecs::SnapshotWriter &writer,
+                                const AnimationComponent &animation) {
+        const auto count{
+            static_cast<std::uint32_t>(animation._animations.size())};
+        if (!ecs::write_value(writer, count)) {
+            return false;
+        }
+        for (const auto &[name, context] : animation._animations) {
+            if (!ecs::write_string(writer, name) ||
+                !ecs::write_value(writer, context)) {
+                return false;
+            }
+        }
+        return ecs::write_string(writer, animation._active_animation) &&
+               ecs::write_value(writer, animation._default_context) &&
+               ecs::write_value(writer, animation._is_started);
+    }
+
+    friend bool debby_ecs_read(ecs::SnapshotReader &reader,
+                               AnimationComponent &animation) {
+        std::uint32_t count{0};
+        if (!ecs::read_value(reader, count)) {
+            return false;
+        }
+        animation._animations.clear();
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::string name{};
+            AnimationContext context{};
+            if (!ecs::read_string(reader, name) ||
+                !ecs::read_value(reader, context)) {
+                return false;
+            }
+            animation._animations.emplace(std::move(name), context);
+        }
+        return ecs::read_string(reader, animation._active_animation) &&
+               ecs::read_value(reader, animation._default_context) &&
+               ecs::read_value(reader, animation._is_started);
+    }
 };
+
+DEBBY_ECS_COMPONENT(AnimationComponent, 5)
 }  // namespace debby
 
 #endif  // DEBBY_COMPONENTS_ANIMATION_COMPONENT_HPP_
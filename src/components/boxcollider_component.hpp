@@ -3,6 +3,8 @@
 
 #include <glm/ext/vector_float2.hpp>
 
+#include "../ecs/types.hpp"
+
 namespace debby {
 
 /* BoxColliderComponent allows an entity to
@@ -17,6 +19,8 @@ class BoxColliderComponent {
                                   glm::vec2 offset = {0, 0})
         : width(width), height(height), offset(offset) {}
 };
+
+DEBBY_ECS_COMPONENT(BoxColliderComponent, 4)
 }  // namespace debby
 
 #endif  // DEBBY_COMPONENTS_BOXCOLLIDER_COMPONENT_HPP_
@@ -0,0 +1,46 @@
+#ifndef DEBBY_COMPONENTS_PARENT_COMPONENT_HPP_
+#define DEBBY_COMPONENTS_PARENT_COMPONENT_HPP_
+
+#include "../ecs/ecs.hpp"
+
+namespace debby {
+
+/* ParentComponent attaches an entity to another entity, such
+ * that its TransformComponent is relative to that of the parent */
+class ParentComponent {
+   public:
+    ecs::Entity parent;
+
+    /* Number of ancestors, maintained by the HierarchySystem */
+    int depth;
+
+    explicit ParentComponent(ecs::Entity parent = ecs::Entity{ecs::INVALID_ID})
+        : parent(parent), depth(1) {}
+
+    ~ParentComponent() = default;
+
+    /* The parent is written as its id, since the registry it
+     * points to is not the one a snapshot is restored into */
+    friend bool debby_ecs_write(ecs::SnapshotWriter &writer,
+                                const ParentComponent &component) {
+        return ecs::write_value(writer, component.parent.get_id()) &&
+               ecs::write_value(writer, component.depth);
+    }
+
+    friend bool debby_ecs_read(ecs::SnapshotReader &reader,
+                               ParentComponent &component) {
+        ecs::Id parent_id{ecs::INVALID_ID};
+        if (!ecs::read_value(reader, parent_id) ||
+            !ecs::read_value(reader, component.depth)) {
+            return false;
+        }
+        component.parent = ecs::Entity{parent_id};
+        component.parent.registry = reader.registry;
+        return true;
+    }
+};
+
+DEBBY_ECS_COMPONENT(ParentComponent, 6)
+}  // namespace debby
+
+#endif  // DEBBY_COMPONENTS_PARENT_COMPONENT_HPP_
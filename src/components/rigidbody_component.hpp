@@ -3,6 +3,8 @@
 
 #include <glm/ext/vector_float2.hpp>
 
+#include "../ecs/types.hpp"
+
 namespace debby {
 
 /* RigidBodyComponent allows an
@@ -17,6 +19,7 @@ class RigidBodyComponent {
     ~RigidBodyComponent() = default;
 };
 
+DEBBY_ECS_COMPONENT(RigidBodyComponent, 2)
 }  // namespace debby
 
 #endif  // DEBBY_COMPONENTS_RIGIDBODY_COMPONENT_HPP_
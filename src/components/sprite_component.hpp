@@ -6,6 +6,9 @@
 #include <string>
 #include <utility>
 
+#include "../ecs/snapshot.hpp"
+#include "../ecs/types.hpp"
+
 namespace debby {
 
 /* SpriteComponent allows an entity to have a
@@ -35,8 +38,31 @@ class SpriteComponent {
     [[nodiscard]] inline SDL_Rect get_rect() const {
         return {src_x, src_y, width, height};
     }
+
+    /* The asset id owns heap memory, so sprites
+     * are written to snapshots field by field */
+    friend bool debby_ecs_write(ecs::SnapshotWriter &writer,
+                                const SpriteComponent &sprite) {
+        return ecs::write_string(writer, sprite.asset_id) &&
+               ecs::write_value(writer, sprite.width) &&
+               ecs::write_value(writer, sprite.height) &&
+               ecs::write_value(writer, sprite.z_index) &&
+               ecs::write_value(writer, sprite.src_x) &&
+               ecs::write_value(writer, sprite.src_y);
+    }
+
+    friend bool debby_ecs_read(ecs::SnapshotReader &reader,
+                               SpriteComponent &sprite) {
+        return ecs::read_string(reader, sprite.asset_id) &&
+               ecs::read_value(reader, sprite.width) &&
+               ecs::read_value(reader, sprite.height) &&
+               ecs::read_value(reader, sprite.z_index) &&
+               ecs::read_value(reader, sprite.src_x) &&
+               ecs::read_value(reader, sprite.src_y);
+    }
 };
 
+DEBBY_ECS_COMPONENT(SpriteComponent, 3)
 }  // namespace debby
 
 #endif  // DEBBY_COMPONENTS_SPRITE_COMPONENT_HPP_
@@ -3,6 +3,8 @@
 
 #include <glm/ext/vector_float2.hpp>
 
+#include "../ecs/types.hpp"
+
 namespace debby {
 
 /* TransformComponent allows an entity a
@@ -19,6 +21,8 @@ class TransformComponent {
 
     ~TransformComponent() = default;
 };
+
+DEBBY_ECS_COMPONENT(TransformComponent, 1)
 }  // namespace debby
 
 #endif  // DEBBY_COMPONENTS_TRANSFORM_COMPONENT_HPP_
@@ -0,0 +1,21 @@
+#ifndef DEBBY_COMPONENTS_WORLDTRANSFORM_COMPONENT_HPP_
+#define DEBBY_COMPONENTS_WORLDTRANSFORM_COMPONENT_HPP_
+
+#include "./transform_component.hpp"
+
+namespace debby {
+
+/* WorldTransformComponent caches the transform of an entity after
+ * applying the transforms of all its parents. It is written by the
+ * HierarchySystem and should otherwise be treated as read-only */
+class WorldTransformComponent : public TransformComponent {
+   public:
+    using TransformComponent::TransformComponent;
+
+    ~WorldTransformComponent() = default;
+};
+
+DEBBY_ECS_COMPONENT(WorldTransformComponent, 7)
+}  // namespace debby
+
+#endif  // DEBBY_COMPONENTS_WORLDTRANSFORM_COMPONENT_HPP_
@@ -0,0 +1,263 @@
+#include "archetype.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cassert>
+
+debby::ecs::Archetype::Archetype(Arena &arena,
+                                 const ComponentSignature &signature,
+                                 std::vector<ComponentInfo> components)
+    : _signature(signature),
+      _components(std::move(components)),
+      _offsets({}),
+      _arena(&arena),
+      _chunks({}),
+      _size(0) {
+    std::sort(_components.begin(), _components.end(),
+              [](const ComponentInfo &a, const ComponentInfo &b) {
+                  return a.id < b.id;
+              });
+    std::fill(std::begin(_column_lookup), std::end(_column_lookup),
+              INVALID_ID);
+    _offsets.resize(_components.size());
+    std::size_t row_size{sizeof(Id)};
+    for (Id column = 0; column < _components.size(); column++) {
+        assert(_components[column].alignment <= alignof(Chunk));
+        _column_lookup[_components[column].id] = column;
+        row_size += _components[column].size;
+    }
+    /* start from the unpadded estimate and shrink
+     * until the aligned columns fit in a chunk */
+    _chunk_capacity = static_cast<Id>(CHUNK_SIZE / row_size);
+    while (_layout(_chunk_capacity) > CHUNK_SIZE) {
+        _chunk_capacity--;
+    }
+    assert(_chunk_capacity > 0);
+    spdlog::trace("created archetype {0} with {1:d} rows per chunk",
+                  _signature.to_string(), _chunk_capacity);
+}
+
+debby::ecs::Archetype::~Archetype() { clear(); }
+
+void debby::ecs::Archetype::_destroy_rows() {
+    for (Id row = 0; row < _size; row++) {
+        for (Id column = 0; column < _components.size(); column++) {
+            _components[column].destroy(_get_address(column, row));
+        }
+    }
+    _size = 0;
+}
+
+std::size_t debby::ecs::Archetype::_layout(Id capacity) {
+    std::size_t offset{capacity * sizeof(Id)};
+    for (Id column = 0; column < _components.size(); column++) {
+        const std::size_t alignment{_components[column].alignment};
+        offset = (offset + alignment - 1) / alignment * alignment;
+        _offsets[column] = offset;
+        offset += capacity * _components[column].size;
+    }
+    return offset;
+}
+
+debby::ecs::MemoryUsage debby::ecs::Archetype::get_memory_usage() const {
+    std::size_t row_size{sizeof(Id)};
+    for (const auto &info : _components) {
+        row_size += info.size;
+    }
+    MemoryUsage usage{_size * row_size, _chunks.size() * sizeof(Chunk)};
+    usage += ecs::get_memory_usage(_chunks);
+    usage += ecs::get_memory_usage(_components);
+    usage += ecs::get_memory_usage(_offsets);
+    return usage;
+}
+
+void debby::ecs::Archetype::compact() {
+    while (_chunks.size() > get_chunk_count()) {
+        _arena->release(_chunks.back());
+        _chunks.pop_back();
+    }
+    _chunks.shrink_to_fit();
+}
+
+void debby::ecs::Archetype::clear() {
+    _destroy_rows();
+    compact();
+}
+
+debby::ecs::Id debby::ecs::Archetype::push(Id entity_id) {
+    if (_size == _chunks.size() * _chunk_capacity) {
+        _chunks.push_back(static_cast<Chunk *>(_arena->allocate()));
+    }
+    const Id row{_size++};
+    _get_entity(row) = entity_id;
+    return row;
+}
+
+debby::ecs::Id debby::ecs::Archetype::erase(
+    Id row, const ComponentSignature &relocated) {
+    for (Id column = 0; column < _components.size(); column++) {
+        if (!relocated.test(_components[column].id)) {
+            _components[column].destroy(_get_address(column, row));
+        }
+    }
+    const Id last{_size - 1};
+    Id moved{INVALID_ID};
+    if (row != last) {
+        for (Id column = 0; column < _components.size(); column++) {
+            _components[column].relocate(_get_address(column, row),
+                                         _get_address(column, last));
+        }
+        moved = _get_entity(last);
+        _get_entity(row) = moved;
+    }
+    _size--;
+    return moved;
+}
+
+debby::ecs::ArchetypeStorage::ArchetypeStorage(Arena &arena)
+    : _arena(&arena),
+      _archetypes(),
+      _archetype_lookup({}),
+      _queries({}),
+      _locations({}) {}
+
+debby::ecs::Archetype &debby::ecs::ArchetypeStorage::_get_or_create(
+    const ComponentSignature &signature, const Archetype *source,
+    const ComponentInfo *const *first_added,
+    const ComponentInfo *const *last_added) {
+    const auto iter{_archetype_lookup.find(signature)};
+    if (iter != _archetype_lookup.end()) {
+        return *iter->second;
+    }
+    std::vector<ComponentInfo> infos{};
+    if (source) {
+        for (const auto &info : source->get_components()) {
+            if (signature.test(info.id)) {
+                infos.push_back(info);
+            }
+        }
+    }
+    for (auto info{first_added}; info != last_added; info++) {
+        if (!source || !source->has_column((*info)->id)) {
+            infos.push_back(**info);
+        }
+    }
+    _archetypes.push_back(
+        std::make_unique<Archetype>(*_arena, signature, infos));
+    Archetype *archetype{_archetypes.back().get()};
+    _archetype_lookup.emplace(signature, archetype);
+    return *archetype;
+}
+
+debby::ecs::ArchetypeStorage::Location &
+debby::ecs::ArchetypeStorage::_get_location(Id entity_id) {
+    const Id index{entity_index(entity_id)};
+    if (index >= _locations.size()) {
+        _locations.resize(index + 1, {nullptr, 0});
+    }
+    return _locations[index];
+}
+
+void debby::ecs::ArchetypeStorage::_move(Id entity_id, Archetype &target) {
+    Location &location{_get_location(entity_id)};
+    Archetype *source{location.archetype};
+    const Id row{target.push(entity_id)};
+    if (source) {
+        const ComponentSignature shared{source->get_signature() &
+                                        target.get_signature()};
+        for (const auto &info : target.get_components()) {
+            if (shared.test(info.id)) {
+                info.relocate(target.get_item(info.id, row),
+                              source->get_item(info.id, location.row));
+            }
+        }
+        const Id moved{source->erase(location.row, shared)};
+        if (moved != INVALID_ID) {
+            _locations[entity_index(moved)].row = location.row;
+        }
+    }
+    location = {&target, row};
+}
+
+void debby::ecs::ArchetypeStorage::instantiate(
+    const std::vector<const ComponentInfo *> &components,
+    const std::vector<const void *> &prototypes, const Id *entity_ids,
+    std::size_t count) {
+    assert(components.size() == prototypes.size());
+    if (components.empty() || count == 0) {
+        return;
+    }
+    ComponentSignature signature{};
+    for (const ComponentInfo *info : components) {
+        signature.set(info->id);
+    }
+    Archetype &target{_get_or_create(signature, nullptr, components.data(),
+                                     components.data() + components.size())};
+    const Id first{target.get_size()};
+    for (std::size_t i = 0; i < count; i++) {
+        Location &location{_get_location(entity_ids[i])};
+        assert(!location.archetype);
+        location = {&target, target.push(entity_ids[i])};
+    }
+    /* rows are consecutive, so each column is filled a chunk at a time */
+    const Id end{first + static_cast<Id>(count)};
+    const Id capacity{target.get_chunk_capacity()};
+    for (Id row = first; row < end;) {
+        const Id run{std::min(capacity - row % capacity, end - row)};
+        for (std::size_t i = 0; i < components.size(); i++) {
+            components[i]->copy(target.get_item(components[i]->id, row),
+                                prototypes[i], run);
+        }
+        row += run;
+    }
+}
+
+void debby::ecs::ArchetypeStorage::remove_entity(Id entity_id) {
+    Location &location{_get_location(entity_id)};
+    if (!location.archetype) {
+        return;
+    }
+    const Id moved{location.archetype->erase(location.row, {})};
+    if (moved != INVALID_ID) {
+        _locations[entity_index(moved)].row = location.row;
+    }
+    location = {nullptr, 0};
+}
+
+debby::ecs::MemoryUsage debby::ecs::ArchetypeStorage::get_memory_usage()
+    const {
+    MemoryUsage usage{ecs::get_memory_usage(_locations)};
+    for (const auto &archetype : _archetypes) {
+        usage += archetype->get_memory_usage();
+    }
+    return usage;
+}
+
+void debby::ecs::ArchetypeStorage::compact() {
+    for (const auto &archetype : _archetypes) {
+        archetype->compact();
+    }
+    _locations.shrink_to_fit();
+}
+
+void debby::ecs::ArchetypeStorage::clear() {
+    for (const auto &archetype : _archetypes) {
+        archetype->clear();
+    }
+    _locations.clear();
+    _locations.shrink_to_fit();
+}
+
+const std::vector<debby::ecs::Archetype *> &
+debby::ecs::ArchetypeStorage::query(const ComponentSignature &signature) {
+    Query &query{_queries[signature]};
+    for (; query.archetypes_seen < _archetypes.size();
+         query.archetypes_seen++) {
+        Archetype *archetype{_archetypes[query.archetypes_seen].get()};
+        if (archetype->get_signature().contains(signature)) {
+            query.matches.push_back(archetype);
+        }
+    }
+    return query.matches;
+}
@@ -0,0 +1,293 @@
+#ifndef DEBBY_ECS_ARCHETYPE_HPP_
+#define DEBBY_ECS_ARCHETYPE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./arena.hpp"
+#include "./types.hpp"
+
+namespace debby::ecs {
+
+/* Size in bytes of each archetype chunk, one arena page */
+constexpr std::size_t CHUNK_SIZE{ARENA_PAGE_SIZE};
+
+/*
+ * Chunk is a fixed-size block of memory holding
+ * the entity ids and component columns of a run
+ * of consecutive rows in an archetype */
+struct alignas(ARENA_PAGE_ALIGNMENT) Chunk {
+    std::byte data[CHUNK_SIZE];
+};
+
+static_assert(sizeof(Chunk) == ARENA_PAGE_SIZE);
+
+/*
+ * Archetype stores every entity that has exactly the same component
+ * signature. Each chunk holds one column per component (SoA), such
+ * that iterating a component streams linearly through memory. Every
+ * chunk is full except the last, since rows are always removed by
+ * moving the last row into the hole */
+class Archetype {
+   private:
+    ComponentSignature _signature;
+
+    /* One column per component, sorted by component id. Vector
+     * index is column, offsets are relative to the chunk start */
+    std::vector<ComponentInfo> _components;
+    std::vector<std::size_t> _offsets;
+
+    /* Index is component id, value is column */
+    Id _column_lookup[MAX_COMPONENTS];
+
+    /* Pages taken from the arena of the registry */
+    Arena *_arena;
+    std::vector<Chunk *> _chunks;
+    Id _chunk_capacity;
+    Id _size;
+
+    /* Destroys every row, keeping the chunks */
+    void _destroy_rows();
+
+    /* Lays out columns for a chunk of capacity rows and
+     * returns the number of bytes the layout requires */
+    std::size_t _layout(Id capacity);
+
+    [[nodiscard]] inline std::byte *_get_address(Id column, Id row) const {
+        return _chunks[row / _chunk_capacity]->data + _offsets[column] +
+               (row % _chunk_capacity) * _components[column].size;
+    }
+
+    [[nodiscard]] inline Id &_get_entity(Id row) const {
+        return get_entities(row / _chunk_capacity)[row % _chunk_capacity];
+    }
+
+   public:
+    Archetype(Arena &arena, const ComponentSignature &signature,
+              std::vector<ComponentInfo> components);
+    ~Archetype();
+
+    Archetype(const Archetype &) = delete;
+    Archetype &operator=(const Archetype &) = delete;
+
+    [[nodiscard]] inline const ComponentSignature &get_signature() const {
+        return _signature;
+    }
+
+    [[nodiscard]] inline Id get_size() const { return _size; }
+
+    [[nodiscard]] inline Id get_chunk_capacity() const {
+        return _chunk_capacity;
+    }
+
+    /* Number of chunks that currently hold rows */
+    [[nodiscard]] inline Id get_chunk_count() const {
+        return (_size + _chunk_capacity - 1) / _chunk_capacity;
+    }
+
+    /* Number of rows held by the given chunk */
+    [[nodiscard]] inline Id get_chunk_size(Id chunk) const {
+        const Id first_row{chunk * _chunk_capacity};
+        return std::min(_chunk_capacity, _size - first_row);
+    }
+
+    [[nodiscard]] inline bool has_column(Id component_id) const {
+        return _column_lookup[component_id] != INVALID_ID;
+    }
+
+    [[nodiscard]] inline const std::vector<ComponentInfo> &get_components()
+        const {
+        return _components;
+    }
+
+    [[nodiscard]] inline Id *get_entities(Id chunk) const {
+        return reinterpret_cast<Id *>(_chunks[chunk]->data);
+    }
+
+    [[nodiscard]] inline Id get_entity(Id row) const {
+        return _get_entity(row);
+    }
+
+    template <typename TComponent>
+    [[nodiscard]] inline TComponent *get_column(Id chunk) const {
+        const Id column{_column_lookup[Component<TComponent>::get_id()]};
+        return reinterpret_cast<TComponent *>(_chunks[chunk]->data +
+                                              _offsets[column]);
+    }
+
+    [[nodiscard]] inline void *get_item(Id component_id, Id row) const {
+        return _get_address(_column_lookup[component_id], row);
+    }
+
+    template <typename TComponent>
+    [[nodiscard]] inline TComponent &get_item(Id row) const {
+        return *static_cast<TComponent *>(
+            get_item(Component<TComponent>::get_id(), row));
+    }
+
+    [[nodiscard]] MemoryUsage get_memory_usage() const;
+
+    /* Releases chunks that no longer hold any rows */
+    void compact();
+
+    /* Destroys every row and releases every chunk */
+    void clear();
+
+    /* Appends a row for the entity, leaving its components
+     * uninitialized, and returns the index of the new row */
+    Id push(Id entity_id);
+
+    /* Destroys the components of row, except those that have already
+     * been relocated out, and fills the hole with the last row.
+     * Returns the id of the entity that moved into row, if any */
+    Id erase(Id row, const ComponentSignature &relocated);
+};
+
+/*
+ * ArchetypeStorage keeps every entity in the archetype matching
+ * its signature and moves it between archetypes whenever a
+ * component is added or removed */
+class ArchetypeStorage {
+   private:
+    struct Location {
+        Archetype *archetype;
+        Id row;
+    };
+
+    /* Archetypes matching a query, kept up to date by matching
+     * archetypes created after the query was last used */
+    struct Query {
+        std::vector<Archetype *> matches;
+        std::size_t archetypes_seen;
+    };
+
+    Arena *_arena;
+    std::vector<std::unique_ptr<Archetype>> _archetypes;
+    std::unordered_map<ComponentSignature, Archetype *> _archetype_lookup;
+    std::unordered_map<ComponentSignature, Query> _queries;
+
+    /* Vector index is equal to entity index */
+    std::vector<Location> _locations;
+
+    /* Finds the archetype for signature, creating it from the
+     * columns of source plus the added components when missing */
+    Archetype &_get_or_create(const ComponentSignature &signature,
+                              const Archetype *source,
+                              const ComponentInfo *const *first_added,
+                              const ComponentInfo *const *last_added);
+
+    inline Archetype &_get_or_create(
+        const ComponentSignature &signature, const Archetype *source,
+        std::initializer_list<const ComponentInfo *> added) {
+        return _get_or_create(signature, source, added.begin(), added.end());
+    }
+
+    Location &_get_location(Id entity_id);
+
+    /* Moves the entity and every component it shares with target */
+    void _move(Id entity_id, Archetype &target);
+
+   public:
+    explicit ArchetypeStorage(Arena &arena);
+    ~ArchetypeStorage() = default;
+
+    template <typename TComponent, typename... TArgs>
+    inline TComponent &emplace(Id entity_id, TArgs &&...args) {
+        const ComponentInfo &info{get_component_info<TComponent>()};
+        Location &location{_get_location(entity_id)};
+        Archetype *source{location.archetype};
+        if (source && source->has_column(info.id)) {
+            TComponent &item{source->get_item<TComponent>(location.row)};
+            item = TComponent(std::forward<TArgs>(args)...);
+            return item;
+        }
+        ComponentSignature signature{source ? source->get_signature()
+                                            : ComponentSignature{}};
+        signature.set(info.id);
+        Archetype &target{_get_or_create(signature, source, {&info})};
+        _move(entity_id, target);
+        const Id row{_get_location(entity_id).row};
+        return *new (target.get_item(info.id, row))
+            TComponent(std::forward<TArgs>(args)...);
+    }
+
+    /* Adds every component at once, such that the entity is
+     * moved to its final archetype a single time */
+    template <typename... TComponents>
+    inline void insert(Id entity_id, TComponents &&...components) {
+        const Archetype *source{_get_location(entity_id).archetype};
+        const ComponentSignature existing{source ? source->get_signature()
+                                                 : ComponentSignature{}};
+        ComponentSignature signature{existing};
+        (signature.set(Component<TComponents>::get_id()), ...);
+        if (signature != existing) {
+            _move(entity_id,
+                  _get_or_create(signature, source,
+                                 {&get_component_info<TComponents>()...}));
+        }
+        const Location &location{_get_location(entity_id)};
+        auto place{[&](auto &&component) {
+            using T = std::decay_t<decltype(component)>;
+            const Id component_id{Component<T>::get_id()};
+            void *item{location.archetype->get_item(component_id,
+                                                    location.row)};
+            if (existing.test(component_id)) {
+                *static_cast<T *>(item) = std::move(component);
+            } else {
+                new (item) T(std::move(component));
+            }
+        }};
+        (place(std::move(components)), ...);
+    }
+
+    template <typename TComponent>
+    inline void remove(Id entity_id) {
+        const Id component_id{Component<TComponent>::get_id()};
+        Archetype *source{_get_location(entity_id).archetype};
+        if (!source || !source->has_column(component_id)) {
+            return;
+        }
+        ComponentSignature signature{source->get_signature()};
+        signature.reset(component_id);
+        if (signature.none()) {
+            remove_entity(entity_id);
+            return;
+        }
+        _move(entity_id, _get_or_create(signature, source, {}));
+    }
+
+    template <typename TComponent>
+    [[nodiscard]] inline TComponent &get(Id entity_id) const {
+        const Location &location{_locations[entity_index(entity_id)]};
+        return location.archetype->get_item<TComponent>(location.row);
+    }
+
+    /* Places count entities without any component in the archetype of
+     * components, where each gets a copy of the matching prototype */
+    void instantiate(const std::vector<const ComponentInfo *> &components,
+                     const std::vector<const void *> &prototypes,
+                     const Id *entity_ids, std::size_t count);
+
+    /* Destroys every component of the entity */
+    void remove_entity(Id entity_id);
+
+    [[nodiscard]] MemoryUsage get_memory_usage() const;
+
+    void compact();
+
+    /* Destroys every entity, keeping the archetypes themselves
+     * such that queries stay valid */
+    void clear();
+
+    /* Returns every archetype whose signature contains signature */
+    const std::vector<Archetype *> &query(const ComponentSignature &signature);
+};
+}  // namespace debby::ecs
+
+#endif  // DEBBY_ECS_ARCHETYPE_HPP_
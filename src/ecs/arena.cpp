@@ -0,0 +1,83 @@
+#include "arena.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+debby::ecs::Arena::Arena() : _blocks(), _free_pages({}) {}
+
+debby::ecs::Arena::~Arena() {
+    if (get_pages_in_use() > 0) {
+        spdlog::warn("destroying arena with {0:d} pages still in use",
+                     get_pages_in_use());
+    }
+}
+
+void *debby::ecs::Arena::allocate() {
+    if (_free_pages.empty()) {
+        /* not value-initialized, pages are handed out uninitialized */
+        _blocks.push_back(std::unique_ptr<Block>(new Block));
+        std::byte *data{_blocks.back()->data};
+        /* reversed, such that pages are handed out in address order */
+        for (std::size_t i = ARENA_PAGES_PER_BLOCK; i > 0; i--) {
+            _free_pages.push_back(data + (i - 1) * ARENA_PAGE_SIZE);
+        }
+        spdlog::trace("arena allocated block {0:d}", _blocks.size());
+    }
+    std::byte *page{_free_pages.back()};
+    _free_pages.pop_back();
+    return page;
+}
+
+void debby::ecs::Arena::release(void *page) {
+    assert(page);
+    _free_pages.push_back(static_cast<std::byte *>(page));
+}
+
+debby::ecs::MemoryUsage debby::ecs::Arena::get_memory_usage() const {
+    MemoryUsage usage{0, _free_pages.size() * ARENA_PAGE_SIZE};
+    usage += ecs::get_memory_usage(_blocks);
+    usage += ecs::get_memory_usage(_free_pages);
+    return usage;
+}
+
+void debby::ecs::Arena::trim() {
+    if (_free_pages.empty()) {
+        return;
+    }
+    /* with both sorted by address, the free pages of each
+     * block are found in a single pass over the free list */
+    std::sort(_free_pages.begin(), _free_pages.end(), std::less<>());
+    std::sort(_blocks.begin(), _blocks.end(), [](const auto &a, const auto &b) {
+        return std::less<>()(a.get(), b.get());
+    });
+    std::vector<std::byte *> kept_pages{};
+    std::vector<std::unique_ptr<Block>> kept_blocks{};
+    auto page{_free_pages.begin()};
+    for (auto &block : _blocks) {
+        const std::byte *first{block->data};
+        const std::byte *last{first + sizeof(Block::data)};
+        while (page != _free_pages.end() && std::less<>()(*page, first)) {
+            kept_pages.push_back(*page++);
+        }
+        const auto block_pages{page};
+        while (page != _free_pages.end() && std::less<>()(*page, last)) {
+            page++;
+        }
+        if (static_cast<std::size_t>(page - block_pages) ==
+            ARENA_PAGES_PER_BLOCK) {
+            continue;
+        }
+        kept_pages.insert(kept_pages.end(), block_pages, page);
+        kept_blocks.push_back(std::move(block));
+    }
+    kept_pages.insert(kept_pages.end(), page, _free_pages.end());
+    /* the last free page is handed out first */
+    std::reverse(kept_pages.begin(), kept_pages.end());
+    spdlog::debug("arena trimmed from {0:d} to {1:d} blocks", _blocks.size(),
+                  kept_blocks.size());
+    _blocks = std::move(kept_blocks);
+    _free_pages = std::move(kept_pages);
+}
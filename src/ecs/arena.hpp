@@ -0,0 +1,62 @@
+#ifndef DEBBY_ECS_ARENA_HPP_
+#define DEBBY_ECS_ARENA_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "./types.hpp"
+
+namespace debby::ecs {
+
+/* Size in bytes of every page handed out by an arena */
+constexpr std::size_t ARENA_PAGE_SIZE{16 * 1024};
+
+/* Pages start on a cache line */
+constexpr std::size_t ARENA_PAGE_ALIGNMENT{64};
+
+/* Pages allocated from the system at once when the arena runs out */
+constexpr std::size_t ARENA_PAGES_PER_BLOCK{16};
+
+/*
+ * Arena hands out fixed-size pages carved from larger blocks. Released
+ * pages are kept for reuse instead of being freed, and trim() returns
+ * blocks to the system once none of their pages are in use. It is not
+ * thread-safe, since pages are only taken and released by structural
+ * changes, which happen on the main thread */
+class Arena {
+   private:
+    struct alignas(ARENA_PAGE_ALIGNMENT) Block {
+        std::byte data[ARENA_PAGE_SIZE * ARENA_PAGES_PER_BLOCK];
+    };
+
+    std::vector<std::unique_ptr<Block>> _blocks;
+    std::vector<std::byte *> _free_pages;
+
+   public:
+    Arena();
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /* Returns an uninitialized page of ARENA_PAGE_SIZE bytes */
+    [[nodiscard]] void *allocate();
+
+    /* Takes back a page, which must have come from this arena */
+    void release(void *page);
+
+    [[nodiscard]] inline std::size_t get_pages_in_use() const {
+        return _blocks.size() * ARENA_PAGES_PER_BLOCK - _free_pages.size();
+    }
+
+    /* Memory of pages that are not handed out, since pages
+     * in use are accounted for by whoever holds them */
+    [[nodiscard]] MemoryUsage get_memory_usage() const;
+
+    /* Frees every block none of whose pages are in use */
+    void trim();
+};
+}  // namespace debby::ecs
+
+#endif  // DEBBY_ECS_ARENA_HPP_
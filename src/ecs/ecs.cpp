@@ -3,16 +3,57 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <tuple>
 
 debby::ecs::IdCounter debby::ecs::IComponent::_next_id{};
+debby::ecs::IdCounter debby::ecs::ISystemType::_next_id{
+    MAX_REGISTERED_SYSTEMS};
+
+debby::ecs::Id debby::ecs::IComponent::_next_dynamic_id() {
+    const Id count{_next_id++};
+    if (count >= MAX_COMPONENTS - MAX_REGISTERED_COMPONENTS) {
+        spdlog::critical(
+            "too many component types, {0:d} ids above the {1:d} registered "
+            "ones are taken, raise DEBBY_ECS_MAX_COMPONENTS",
+            MAX_COMPONENTS - MAX_REGISTERED_COMPONENTS,
+            MAX_REGISTERED_COMPONENTS);
+        std::abort();
+    }
+    return MAX_COMPONENTS - 1 - count;
+}
+
+/* Zero is never handed out, such that it marks an empty cache */
+static std::atomic<std::size_t> next_registry_serial{1};
+
+static std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
 
 debby::ecs::Entity::Entity(Id id) : _id(id), registry(nullptr) {}
 
 debby::ecs::Id debby::ecs::Entity::get_id() const { return _id; }
 
+debby::ecs::Id debby::ecs::Entity::get_index() const {
+    return entity_index(_id);
+}
+
+debby::ecs::Id debby::ecs::Entity::get_generation() const {
+    return entity_generation(_id);
+}
+
 void debby::ecs::Entity::kill() {
     registry->destroy_entity(*this);
-    spdlog::debug("destroying entity {0:d}", _id);
+    spdlog::debug("destroying entity {0:d}", get_index());
+}
+
+void debby::ecs::Entity::set_enabled(bool enabled) {
+    registry->set_enabled(*this, enabled);
+}
+
+bool debby::ecs::Entity::is_enabled() const {
+    return registry->is_enabled(*this);
 }
 
 bool debby::ecs::Entity::operator==(const Entity &other) const {
@@ -36,96 +77,969 @@ const debby::ecs::ComponentSignature &debby::ecs::System::get_signature()
     return _signature;
 }
 
+bool debby::ecs::System::conflicts_with(const System &other) const {
+    return _writes.intersects(other._reads | other._writes) ||
+           other._writes.intersects(_reads);
+}
+
 const std::vector<debby::ecs::Entity> &debby::ecs::System::get_entities()
     const {
     return _entities;
 }
 
+debby::ecs::Tick debby::ecs::System::begin_run() {
+    const Tick previous{_last_run};
+    _last_run = registry->advance_tick();
+    return previous;
+}
+
+debby::ecs::MemoryUsage debby::ecs::System::get_memory_usage() const {
+    MemoryUsage usage{ecs::get_memory_usage(_entities)};
+    usage += ecs::get_memory_usage(_entity_slots);
+    return usage;
+}
+
+void debby::ecs::System::compact() {
+    while (!_entity_slots.empty() && _entity_slots.back() == INVALID_ID) {
+        _entity_slots.pop_back();
+    }
+    _entity_slots.shrink_to_fit();
+    _entities.shrink_to_fit();
+}
+
 void debby::ecs::System::add_entity(Entity entity) {
+    if (has_entity(entity)) {
+        return;
+    }
+    const Id index{entity.get_index()};
+    if (index >= _entity_slots.size()) {
+        _entity_slots.resize(index + 1, INVALID_ID);
+    }
+    _entity_slots[index] = static_cast<Id>(_entities.size());
     _entities.push_back(entity);
+    _membership_version++;
 }
 
 void debby::ecs::System::remove_entity(Entity entity) {
-    auto iter{std::remove_if(_entities.begin(), _entities.end(),
-                             [&](Entity other) { return entity == other; })};
-    if (iter == _entities.end()) {
-        spdlog::warn("tried to remove non-existent entity {0:d} from registry",
-                     entity.get_id());
+    if (!has_entity(entity)) {
+        spdlog::warn("tried to remove non-existent entity {0:d} from system",
+                     entity.get_index());
         return;
     }
-    _entities.erase(iter, _entities.end());
+    const Id slot{_entity_slots[entity.get_index()]};
+    const Entity last{_entities.back()};
+    _entities[slot] = last;
+    _entity_slots[last.get_index()] = slot;
+    _entities.pop_back();
+    _entity_slots[entity.get_index()] = INVALID_ID;
+    _membership_version++;
+}
+
+void debby::ecs::System::clear_entities() {
+    _entities.clear();
+    _entity_slots.clear();
+    _membership_version++;
 }
 
-debby::ecs::Registry::Registry()
+debby::ecs::CommandBuffer::CommandBuffer(Registry *registry)
+    : _registry(registry), _pages(), _page(0), _key(0), _sequence(0) {}
+
+debby::ecs::CommandBuffer::~CommandBuffer() { clear(); }
+
+debby::ecs::CommandBuffer::Command &debby::ecs::CommandBuffer::_push(
+    CommandType type, Entity entity, std::size_t payload_size,
+    std::size_t payload_alignment) {
+    const std::size_t payload_offset{
+        align_up(sizeof(Command), payload_alignment)};
+    const std::size_t size{
+        align_up(payload_offset + payload_size, alignof(Command))};
+    while (_page < _pages.size() &&
+           _pages[_page].size + size > _pages[_page].capacity) {
+        _page++;
+    }
+    if (_page == _pages.size()) {
+        const std::size_t capacity{std::max(PAGE_SIZE, size)};
+        _pages.push_back(
+            {std::make_unique<std::byte[]>(capacity), 0, capacity});
+    }
+    Page &page{_pages[_page]};
+    std::byte *address{page.data.get() + page.size};
+    page.size += size;
+    return *new (address)
+        Command{nullptr, nullptr, address + payload_offset, _key,
+                entity.get_id(), _sequence++, static_cast<std::uint32_t>(size),
+                type};
+}
+
+debby::ecs::Entity debby::ecs::CommandBuffer::create_entity() {
+    Entity entity{_registry->_reserve_entity()};
+    entity.registry = _registry;
+    _push(CommandType::create, entity);
+    return entity;
+}
+
+void debby::ecs::CommandBuffer::destroy_entity(Entity entity) {
+    _push(CommandType::destroy, entity);
+}
+
+void debby::ecs::CommandBuffer::clear() {
+    _for_each([this](Command &command) {
+        if (command.type == CommandType::create) {
+            _registry->_release_reserved_entity(Entity{command.entity_id});
+        }
+    });
+    _reset();
+}
+
+void debby::ecs::CommandBuffer::_reset() {
+    _for_each([](Command &command) {
+        if (command.release) {
+            command.release(command.payload);
+        }
+    });
+    for (auto &page : _pages) {
+        page.size = 0;
+    }
+    _page = 0;
+    _key = 0;
+    _sequence = 0;
+}
+
+debby::ecs::MemoryUsage debby::ecs::CommandBuffer::get_memory_usage() const {
+    MemoryUsage usage{ecs::get_memory_usage(_pages)};
+    for (const auto &page : _pages) {
+        usage += {page.size, page.capacity};
+    }
+    return usage;
+}
+
+void debby::ecs::CommandBuffer::compact() {
+    if (_page == 0 && _pages.size() > 1) {
+        _pages.resize(1);
+    }
+    _pages.shrink_to_fit();
+}
+
+debby::ecs::Registry::Registry(Storage storage)
     : _entity_counter({}),
+      _tick(1),
+      _storage(storage),
+      _arena(),
+      _archetypes(_arena),
       _component_pools({}),
       _entity_component_signatures({}),
-      _systems({}),
-      _entities_add_queue({}),
-      _entities_remove_queue({}) {}
+      _entity_ids({}),
+      _resources(),
+      _systems(),
+      _system_order({}),
+      _phases(),
+      _queries(),
+      _entities_changed_queue({}),
+      _entities_remove_queue({}),
+      _disabled_count(0),
+      _entity_changed({}),
+      _released_ids({}),
+      _serial(next_registry_serial++),
+      _command_buffers(),
+      _command_buffer_order({}),
+      _groups(),
+      _commands({}),
+      _observers(),
+      _observed(),
+      _next_observer_id(0),
+      _is_dispatching(false),
+      _observer_batch({}),
+      _changed_ids({}) {}
 
-debby::ecs::Entity debby::ecs::Registry::create_entity() {
-    Id entity_id{};
+debby::ecs::Entity debby::ecs::Registry::_reserve_entity() {
+    std::lock_guard<std::mutex> lock(_reserve_mutex);
     if (_free_ids.empty()) {
-        IdCounter new_id{_entity_counter++};
-        entity_id = new_id.load();
-        if (entity_id >=
-            static_cast<unsigned int>(_entity_component_signatures.size())) {
-            // resize by one, since the resizing should be rare
-            // so using the default vector resize could be expensive
-            _entity_component_signatures.resize(entity_id + 1);
+        const Id index{_entity_counter++};
+        assert(index < MAX_ENTITIES);
+        return Entity{make_entity_id(index, 0)};
+    }
+    const Id index{_free_ids.front()};
+    _free_ids.pop_front();
+    return Entity{make_entity_id(index, entity_generation(_entity_ids[index]))};
+}
+
+void debby::ecs::Registry::_release_reserved_entity(Entity entity) {
+    std::lock_guard<std::mutex> lock(_reserve_mutex);
+    _released_ids.push_back(entity.get_id());
+}
+
+void debby::ecs::Registry::_recycle_released_entities() {
+    std::lock_guard<std::mutex> lock(_reserve_mutex);
+    for (const Id entity_id : _released_ids) {
+        const Id index{entity_index(entity_id)};
+        if (index >= _entity_ids.size()) {
+            _entity_component_signatures.resize(index + 1);
+            _entity_ids.resize(index + 1);
+            _entity_changed.resize(index + 1);
         }
-    } else {
-        entity_id = _free_ids.front();
-        _free_ids.pop_front();
+        /* the same as a destroyed entity, such that
+         * handles to the reserved one are stale */
+        _entity_ids[index] = make_entity_id(
+            ENTITY_INDEX_MASK, entity_generation(entity_id) + 1);
+        _free_ids.push_back(index);
+    }
+    _released_ids.clear();
+}
+
+void debby::ecs::Registry::_materialize_entity(Entity entity) {
+    const Id index{entity.get_index()};
+    if (index >=
+        static_cast<unsigned int>(_entity_component_signatures.size())) {
+        // resize by one, since the resizing should be rare
+        // so using the default vector resize could be expensive
+        _entity_component_signatures.resize(index + 1);
+        _entity_ids.resize(index + 1);
+        _entity_changed.resize(index + 1);
     }
-    spdlog::trace("adding entity {0:d} to registry", entity_id);
-    Entity entity{entity_id};
+    _entity_ids[index] = entity.get_id();
+    spdlog::trace("adding entity {0:d} (generation {1:d}) to registry",
+                  index, entity.get_generation());
+    entity.registry = this;
+    _queue_signature_change(entity);
+}
+
+debby::ecs::Entity debby::ecs::Registry::create_entity() {
+    Entity entity{_reserve_entity()};
+    _materialize_entity(entity);
     entity.registry = this;
-    _entities_add_queue.insert(entity);
     return entity;
 }
 
-void debby::ecs::Registry::destroy_entity(Entity entity) {
-    _entities_remove_queue.insert(entity);
+debby::ecs::CommandBuffer &debby::ecs::Registry::get_command_buffer() {
+    /* the last buffer used by this thread, which avoids
+     * taking the lock unless the thread switches registry */
+    thread_local std::pair<std::size_t, CommandBuffer *> cache{0, nullptr};
+    if (cache.first == _serial) {
+        return *cache.second;
+    }
+    std::lock_guard<std::mutex> lock(_command_buffers_mutex);
+    auto &buffer{_command_buffers[std::this_thread::get_id()]};
+    if (!buffer) {
+        buffer = std::make_unique<CommandBuffer>(this);
+        _command_buffer_order.push_back(buffer.get());
+    }
+    cache = {_serial, buffer.get()};
+    return *buffer;
 }
 
-void debby::ecs::Registry::_add_entity_to_systems(Entity entity) {
-    const Id entity_id{entity.get_id()};
-    const ComponentSignature &entity_component_signature{
-        _entity_component_signatures[entity_id]};
-    for (auto &system : _systems) {
-        const auto system_component_signature{system.second->get_signature()};
-        const bool is_interested{
-            (entity_component_signature & system_component_signature) ==
-            system_component_signature};
-        if (is_interested) {
-            spdlog::trace("adding entity {0:d} to {1}", entity_id,
-                          system.first.name());
-            system.second->add_entity(entity);
+void debby::ecs::Registry::_play_commands() {
+    for (CommandBuffer *buffer : _command_buffer_order) {
+        buffer->_for_each([this](CommandBuffer::Command &command) {
+            _commands.push_back(&command);
+        });
+    }
+    if (_commands.empty()) {
+        return;
+    }
+    /* stable, such that ties keep the order buffers were created in */
+    std::stable_sort(_commands.begin(), _commands.end(),
+                     [](const CommandBuffer::Command *a,
+                        const CommandBuffer::Command *b) {
+                         return std::tie(a->key, a->sequence) <
+                                std::tie(b->key, b->sequence);
+                     });
+    /* every entity is created before anything else is played
+     * back, so no command can refer to an entity not yet alive */
+    for (const auto *command : _commands) {
+        if (command->type == CommandBuffer::CommandType::create) {
+            _materialize_entity(Entity{command->entity_id});
+        }
+    }
+    for (const auto *command : _commands) {
+        Entity entity{command->entity_id};
+        entity.registry = this;
+        if (command->type == CommandBuffer::CommandType::create ||
+            !is_alive(entity)) {
+            continue;
+        }
+        if (command->type == CommandBuffer::CommandType::destroy) {
+            destroy_entity(entity);
+        } else {
+            command->apply(*this, entity, command->payload);
+        }
+    }
+    spdlog::trace("played back {0:d} commands", _commands.size());
+    _commands.clear();
+    for (auto &buffer : _command_buffers) {
+        buffer.second->_reset();
+    }
+}
+
+std::vector<debby::ecs::Entity> debby::ecs::Registry::create_entities(
+    std::size_t count) {
+    std::vector<Entity> entities{};
+    entities.reserve(count);
+    {
+        /* command buffers reserve from the same free
+         * list, possibly from other threads */
+        std::lock_guard<std::mutex> lock(_reserve_mutex);
+        const auto recycled{
+            static_cast<Id>(std::min(count, _free_ids.size()))};
+        const auto created{static_cast<Id>(count) - recycled};
+        const Id first_index{_entity_counter.fetch_add(created)};
+        const Id end_index{first_index + created};
+        assert(end_index <= MAX_ENTITIES);
+        if (end_index > _entity_component_signatures.size()) {
+            _entity_component_signatures.resize(end_index);
+            _entity_ids.resize(end_index);
+            _entity_changed.resize(end_index);
         }
+        for (Id i = 0; i < recycled; i++) {
+            const Id index{_free_ids.front()};
+            _free_ids.pop_front();
+            _entity_ids[index] =
+                make_entity_id(index, entity_generation(_entity_ids[index]));
+            entities.emplace_back(_entity_ids[index]);
+        }
+        for (Id index = first_index; index < end_index; index++) {
+            _entity_ids[index] = make_entity_id(index, 0);
+            entities.emplace_back(_entity_ids[index]);
+        }
+    }
+    spdlog::trace("adding {0:d} entities to registry", count);
+    _entities_changed_queue.reserve(_entities_changed_queue.size() + count);
+    for (auto &entity : entities) {
+        entity.registry = this;
+        _queue_signature_change(entity);
+    }
+    return entities;
+}
+
+std::vector<debby::ecs::Entity> debby::ecs::Registry::instantiate(
+    const Prefab &prefab, std::size_t count) {
+    std::vector<Entity> entities{create_entities(count)};
+    std::vector<Id> entity_ids(count);
+    for (std::size_t i = 0; i < count; i++) {
+        entity_ids[i] = entities[i].get_id();
+    }
+    if (_storage == Storage::archetypes) {
+        std::vector<const ComponentInfo *> components{};
+        std::vector<const void *> prototypes{};
+        for (const auto &prototype : prefab._prototypes) {
+            components.push_back(prototype.info);
+            prototypes.push_back(prototype.value.get());
+        }
+        _archetypes.instantiate(components, prototypes, entity_ids.data(),
+                                count);
+    } else {
+        for (const auto &prototype : prefab._prototypes) {
+            IPool &pool{prototype.get_pool(*this)};
+            pool.append(prototype.value.get(), entity_ids.data(), count);
+            if (pool.get_group()) {
+                for (const Id entity_id : entity_ids) {
+                    _notify_added(pool, entity_id);
+                }
+            }
+        }
+    }
+    const ComponentSignature &signature{prefab.get_signature()};
+    for (const Entity entity : entities) {
+        _entity_component_signatures[entity.get_index()] = signature;
+    }
+    if (signature.test(Component<Disabled>::get_id())) {
+        _disabled_count += count;
+    }
+    const ComponentSignature observed{
+        signature &
+        _observed[static_cast<std::size_t>(ComponentEvent::construct)]};
+    for (Id component_id = 0; observed.any() && component_id < MAX_COMPONENTS;
+         component_id++) {
+        if (!observed.test(component_id)) {
+            continue;
+        }
+        for (const Entity entity : entities) {
+            _observe(ComponentEvent::construct, component_id, entity);
+        }
+    }
+    spdlog::trace("instantiated {0:d} entities from prefab", count);
+    return entities;
+}
+
+void debby::ecs::Registry::destroy_entity(Entity entity) {
+    assert(is_alive(entity));
+    _entities_remove_queue.push_back(entity);
+}
+
+bool debby::ecs::Registry::_is_interested(
+    const System &system, const ComponentSignature &signature) {
+    const auto &system_signature{system.get_signature()};
+    const Id disabled_id{Component<Disabled>::get_id()};
+    /* disabled entities only belong to systems asking for them */
+    return signature.contains(system_signature) &&
+           !signature.intersects(system.get_exclusions()) &&
+           (!signature.test(disabled_id) || system_signature.test(disabled_id));
+}
+
+void debby::ecs::Registry::_update_membership(
+    System &system, Entity entity, const ComponentSignature &signature,
+    const char *name) {
+    const bool is_interested{_is_interested(system, signature)};
+    const bool is_member{system.has_entity(entity)};
+    if (is_interested && !is_member) {
+        spdlog::trace("adding entity {0:d} to {1}", entity.get_index(), name);
+        system.add_entity(entity);
+    } else if (!is_interested && is_member) {
+        spdlog::trace("removing entity {0:d} from {1}", entity.get_index(),
+                      name);
+        system.remove_entity(entity);
+    }
+}
+
+void debby::ecs::Registry::_update_entity_systems(Entity entity) {
+    const ComponentSignature &signature{
+        _entity_component_signatures[entity.get_index()]};
+    for (System *system : _system_order) {
+        _update_membership(*system, entity, signature,
+                           typeid(*system).name());
+    }
+    for (const auto &query : _queries) {
+        _update_membership(*query.second, entity, signature, "query");
     }
 }
 
 void debby::ecs::Registry::_remove_entity_from_systems(Entity entity) {
-    for (auto &system : _systems) {
-        // TODO also remove entity components
-        spdlog::trace("removing entity {0:d} from {1}", entity.get_id(),
-                      system.first.name());
-        system.second->remove_entity(entity);
+    for (System *system : _system_order) {
+        if (system->has_entity(entity)) {
+            spdlog::trace("removing entity {0:d} from {1}",
+                          entity.get_index(), typeid(*system).name());
+            system->remove_entity(entity);
+        }
+    }
+    for (const auto &query : _queries) {
+        if (query.second->has_entity(entity)) {
+            query.second->remove_entity(entity);
+        }
+    }
+}
+
+void debby::ecs::Registry::_release_queries() {
+    for (auto iter = _queries.begin(); iter != _queries.end();) {
+        if (iter->second.use_count() == 1) {
+            spdlog::trace("dropping query without handles");
+            iter = _queries.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
+debby::ecs::Query debby::ecs::Registry::query(
+    const ComponentSignature &include, const ComponentSignature &exclude) {
+    std::shared_ptr<System> &cache{_queries[{include, exclude}]};
+    if (cache) {
+        return Query(cache);
+    }
+    cache = std::make_shared<System>();
+    cache->registry = this;
+    cache->require_components(include, Access::read);
+    cache->exclude_components(exclude);
+    /* every entity alive is matched right away, later changes are
+     * picked up by update() the same way as for systems */
+    for (Id index = 0; index < _entity_ids.size(); index++) {
+        Entity entity{_entity_ids[index]};
+        if (entity.get_index() != index) {
+            continue;
+        }
+        entity.registry = this;
+        if (_is_interested(*cache, _entity_component_signatures[index])) {
+            cache->add_entity(entity);
+        }
+    }
+    spdlog::debug("cached query of {0:d} entities",
+                  cache->get_entities().size());
+    return Query(cache);
+}
+
+void debby::ecs::Registry::_remove_entity_components(Entity entity) {
+    if (_storage == Storage::archetypes) {
+        _archetypes.remove_entity(entity.get_id());
+        return;
+    }
+    const ComponentSignature &signature{
+        _entity_component_signatures[entity.get_index()]};
+    for (Id component_id = 0; component_id < _component_pools.size();
+         component_id++) {
+        if (signature.test(component_id) && _component_pools[component_id]) {
+            _notify_removed(*_component_pools[component_id], entity.get_id());
+            _component_pools[component_id]->remove(entity.get_id());
+        }
     }
 }
 
 void debby::ecs::Registry::update() {
-    for (auto entity : _entities_add_queue) {
-        _add_entity_to_systems(entity);
+    _play_commands();
+    _recycle_released_entities();
+    for (auto entity : _entities_changed_queue) {
+        _entity_changed[entity.get_index()] = false;
+        if (is_alive(entity)) {
+            _update_entity_systems(entity);
+        }
     }
-    _entities_add_queue.clear();
+    _entities_changed_queue.clear();
     for (auto entity : _entities_remove_queue) {
-        const Id entity_id{entity.get_id()};
+        /* an entity may have been destroyed more than once */
+        if (!is_alive(entity)) {
+            continue;
+        }
+        const Id index{entity.get_index()};
         _remove_entity_from_systems(entity);
-        _entity_component_signatures[entity_id].reset();
-        _free_ids.push_back(entity_id);
+        _observe_components(ComponentEvent::destroy, entity);
+        _remove_entity_components(entity);
+        if (!is_enabled(entity)) {
+            _disabled_count--;
+        }
+        _entity_component_signatures[index].reset();
+        /* invalidate every outstanding handle to the entity, the
+         * index is kept invalid until the entity is recycled */
+        _entity_ids[index] = make_entity_id(ENTITY_INDEX_MASK,
+                                            entity.get_generation() + 1);
+        _free_ids.push_back(index);
+    }
+    _entities_remove_queue.clear();
+    _release_queries();
+    _dispatch_observers();
+}
+
+void debby::ecs::Registry::clear() {
+    /* entities reserved by command buffers become alive first */
+    _play_commands();
+    _recycle_released_entities();
+    for (Id index = 0; index < _entity_ids.size(); index++) {
+        Entity entity{_entity_ids[index]};
+        if (entity.get_index() != index) {
+            continue;
+        }
+        entity.registry = this;
+        _observe_components(ComponentEvent::destroy, entity);
+        _entity_component_signatures[index].reset();
+        _entity_changed[index] = false;
+        _entity_ids[index] = make_entity_id(ENTITY_INDEX_MASK,
+                                            entity.get_generation() + 1);
+        _free_ids.push_back(index);
     }
+    _entities_changed_queue.clear();
     _entities_remove_queue.clear();
+    _disabled_count = 0;
+    for (System *system : _system_order) {
+        system->clear_entities();
+    }
+    for (const auto &query : _queries) {
+        query.second->clear_entities();
+    }
+    for (const auto &pool : _component_pools) {
+        if (pool) {
+            pool->flush();
+        }
+    }
+    for (const auto &group : _groups) {
+        group.second->on_cleared();
+    }
+    _archetypes.clear();
+    _arena.trim();
+    spdlog::debug("cleared registry, {0:d} arena pages still in use",
+                  _arena.get_pages_in_use());
+    _dispatch_observers();
+}
+
+void debby::ecs::Registry::_observe_components(ComponentEvent event,
+                                               Entity entity) {
+    const ComponentSignature &signature{
+        _entity_component_signatures[entity.get_index()]};
+    if (!signature.intersects(_observed[static_cast<std::size_t>(event)])) {
+        return;
+    }
+    for (Id component_id = 0; component_id < _observers.size();
+         component_id++) {
+        if (signature.test(component_id)) {
+            _observe(event, component_id, entity);
+        }
+    }
+}
+
+void debby::ecs::Registry::run_systems(Phase phase, float delta_time) {
+    for (System *system : _phases[static_cast<std::size_t>(phase)]) {
+        if (system->is_enabled()) {
+            system->update(delta_time);
+        }
+    }
+}
+
+debby::ecs::Id debby::ecs::Registry::_connect_observer(
+    ComponentEvent event, Id component_id, ObserverCallback callback) {
+    assert(!_is_dispatching);
+    if (component_id >= _observers.size()) {
+        _observers.resize(component_id + 1);
+    }
+    ComponentObservers &observers{_observers[component_id]};
+    const auto event_index{static_cast<std::size_t>(event)};
+    if (event == ComponentEvent::update &&
+        observers.callbacks[event_index].empty()) {
+        /* only report changes made from now on */
+        observers.last_dispatch = advance_tick();
+    }
+    const Id observer_id{_next_observer_id++};
+    observers.callbacks[event_index].emplace_back(observer_id,
+                                                  std::move(callback));
+    _observed[event_index].set(component_id);
+    return observer_id;
+}
+
+void debby::ecs::Registry::disconnect_observer(Id observer_id) {
+    assert(!_is_dispatching);
+    for (Id component_id = 0; component_id < _observers.size();
+         component_id++) {
+        ComponentObservers &observers{_observers[component_id]};
+        for (std::size_t event = 0; event < COMPONENT_EVENT_COUNT; event++) {
+            auto &callbacks{observers.callbacks[event]};
+            const auto callback{std::find_if(
+                callbacks.begin(), callbacks.end(),
+                [observer_id](const auto &pair) {
+                    return pair.first == observer_id;
+                })};
+            if (callback == callbacks.end()) {
+                continue;
+            }
+            callbacks.erase(callback);
+            if (callbacks.empty()) {
+                _observed[event].reset(component_id);
+                if (event == static_cast<std::size_t>(
+                                 ComponentEvent::construct)) {
+                    observers.constructed.clear();
+                } else if (event == static_cast<std::size_t>(
+                                        ComponentEvent::destroy)) {
+                    observers.destroyed.clear();
+                }
+            }
+            return;
+        }
+    }
+    spdlog::warn("tried to disconnect non-existent observer {0:d}",
+                 observer_id);
+}
+
+void debby::ecs::Registry::_dispatch_observers() {
+    if (std::none_of(_observed.begin(), _observed.end(),
+                     [](const ComponentSignature &observed) {
+                         return observed.any();
+                     })) {
+        return;
+    }
+    _is_dispatching = true;
+    /* every construct is dispatched before any update or destroy */
+    const auto construct{static_cast<std::size_t>(ComponentEvent::construct)};
+    for (auto &observers : _observers) {
+        if (observers.constructed.empty()) {
+            continue;
+        }
+        /* swapped out, since callbacks may queue new events */
+        _observer_batch.swap(observers.constructed);
+        for (const auto &callback : observers.callbacks[construct]) {
+            callback.second(_observer_batch);
+        }
+        _observer_batch.clear();
+    }
+    const auto update{static_cast<std::size_t>(ComponentEvent::update)};
+    if (_storage == Storage::pools && _observed[update].any()) {
+        const Tick now{advance_tick()};
+        for (Id component_id = 0; component_id < _observers.size();
+             component_id++) {
+            ComponentObservers &observers{_observers[component_id]};
+            if (observers.callbacks[update].empty() ||
+                component_id >= _component_pools.size() ||
+                !_component_pools[component_id]) {
+                continue;
+            }
+            _changed_ids.clear();
+            _component_pools[component_id]->collect_changed(
+                observers.last_dispatch, _changed_ids);
+            observers.last_dispatch = now;
+            if (_changed_ids.empty()) {
+                continue;
+            }
+            for (const Id entity_id : _changed_ids) {
+                Entity entity{entity_id};
+                entity.registry = this;
+                _observer_batch.push_back(entity);
+            }
+            for (const auto &callback : observers.callbacks[update]) {
+                callback.second(_observer_batch);
+            }
+            _observer_batch.clear();
+        }
+    }
+    const auto destroy{static_cast<std::size_t>(ComponentEvent::destroy)};
+    for (auto &observers : _observers) {
+        if (observers.destroyed.empty()) {
+            continue;
+        }
+        _observer_batch.swap(observers.destroyed);
+        for (const auto &callback : observers.callbacks[destroy]) {
+            callback.second(_observer_batch);
+        }
+        _observer_batch.clear();
+    }
+    _is_dispatching = false;
+}
+
+debby::ecs::MemoryUsage debby::ecs::Registry::get_memory_usage() const {
+    MemoryUsage usage{ecs::get_memory_usage(_entity_component_signatures)};
+    usage += ecs::get_memory_usage(_entity_ids);
+    usage += ecs::get_memory_usage(_entities_changed_queue);
+    usage += ecs::get_memory_usage(_entities_remove_queue);
+    usage += ecs::get_memory_usage(_commands);
+    usage += ecs::get_memory_usage(_observer_batch);
+    usage += ecs::get_memory_usage(_changed_ids);
+    usage += ecs::get_memory_usage(_released_ids);
+    usage += ecs::get_memory_usage(_command_buffer_order);
+    for (const auto &observers : _observers) {
+        usage += ecs::get_memory_usage(observers.constructed);
+        usage += ecs::get_memory_usage(observers.destroyed);
+    }
+    for (const auto &buffer : _command_buffers) {
+        usage += buffer.second->get_memory_usage();
+    }
+    usage += {_free_ids.size() * sizeof(Id), _free_ids.size() * sizeof(Id)};
+    usage += {_entity_changed.size() / 8, _entity_changed.capacity() / 8};
+    for (const auto &pool : _component_pools) {
+        if (pool) {
+            usage += pool->get_memory_usage();
+        }
+    }
+    usage += _archetypes.get_memory_usage();
+    usage += _arena.get_memory_usage();
+    usage += ecs::get_memory_usage(_resources);
+    for (const auto &resource : _resources) {
+        if (resource) {
+            usage += {resource->get_size(), resource->get_size()};
+        }
+    }
+    for (const System *system : _system_order) {
+        usage += system->get_memory_usage();
+    }
+    for (const auto &query : _queries) {
+        usage += query.second->get_memory_usage();
+    }
+    return usage;
+}
+
+std::size_t debby::ecs::Registry::compact() {
+    const MemoryUsage before{get_memory_usage()};
+    for (const auto &pool : _component_pools) {
+        if (pool) {
+            pool->compact();
+        }
+    }
+    _archetypes.compact();
+    _arena.trim();
+    for (System *system : _system_order) {
+        system->compact();
+    }
+    _release_queries();
+    for (const auto &query : _queries) {
+        query.second->compact();
+    }
+    _entities_changed_queue.shrink_to_fit();
+    _entities_remove_queue.shrink_to_fit();
+    _commands.shrink_to_fit();
+    _observer_batch.shrink_to_fit();
+    _changed_ids.shrink_to_fit();
+    for (auto &observers : _observers) {
+        observers.constructed.shrink_to_fit();
+        observers.destroyed.shrink_to_fit();
+    }
+    for (auto &buffer : _command_buffers) {
+        buffer.second->compact();
+    }
+    _free_ids.shrink_to_fit();
+    const MemoryUsage after{get_memory_usage()};
+    spdlog::debug(
+        "compacted registry from {0:d} to {1:d} bytes ({2:d} bytes in use)",
+        before.reserved, after.reserved, after.used);
+    /* tables reallocated while compacting may end up larger */
+    return before.reserved > after.reserved ? before.reserved - after.reserved
+                                            : 0;
+}
+
+bool debby::ecs::Registry::snapshot(SnapshotWriter &writer) const {
+    if (_storage != Storage::pools) {
+        spdlog::error("snapshots require pool storage");
+        return false;
+    }
+    static_assert(std::is_trivially_copyable_v<ComponentSignature>);
+    const auto entity_count{static_cast<Id>(_entity_ids.size())};
+    const std::vector<Id> free_ids(_free_ids.begin(), _free_ids.end());
+    const auto free_count{static_cast<Id>(free_ids.size())};
+    Id pool_count{0};
+    for (const auto &pool : _component_pools) {
+        pool_count += pool ? 1 : 0;
+    }
+    bool is_written{
+        write_value(writer, SNAPSHOT_MAGIC) &&
+        write_value(writer, SNAPSHOT_VERSION) &&
+        write_value(writer, MAX_COMPONENTS) &&
+        write_value(writer, entity_count) &&
+        writer.write(_entity_ids.data(), entity_count * sizeof(Id)) &&
+        writer.write(_entity_component_signatures.data(),
+                     entity_count * sizeof(ComponentSignature)) &&
+        write_value(writer, free_count) &&
+        writer.write(free_ids.data(), free_count * sizeof(Id)) &&
+        write_value(writer, pool_count)};
+    for (Id component_id = 0;
+         is_written && component_id < _component_pools.size();
+         component_id++) {
+        if (const auto &pool{_component_pools[component_id]}) {
+            is_written =
+                write_value(writer, component_id) && pool->write(writer);
+        }
+    }
+    if (!is_written) {
+        spdlog::error("failed to write snapshot of registry");
+        return false;
+    }
+    spdlog::debug("wrote snapshot of {0:d} entity slots and {1:d} pools",
+                  entity_count, pool_count);
+    return true;
+}
+
+bool debby::ecs::Registry::restore(SnapshotReader &reader) {
+    if (_storage != Storage::pools) {
+        spdlog::error("snapshots require pool storage");
+        return false;
+    }
+    std::uint32_t magic{0};
+    std::uint32_t version{0};
+    unsigned int max_components{0};
+    if (!read_value(reader, magic) || !read_value(reader, version) ||
+        !read_value(reader, max_components)) {
+        spdlog::error("failed to read snapshot header");
+        return false;
+    }
+    if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION ||
+        max_components != MAX_COMPONENTS) {
+        spdlog::error(
+            "snapshot version {0:d} with {1:d} components does not match "
+            "version {2:d} with {3:d} components",
+            version, max_components, SNAPSHOT_VERSION, MAX_COMPONENTS);
+        return false;
+    }
+    clear();
+    /* from here on a failure leaves the registry half restored, so
+     * it is emptied before returning. Entities are not taken back by
+     * systems until the end, so only the tables need resetting */
+    const auto fail{[this](const char *reason) {
+        spdlog::error("failed to restore snapshot: {0}", reason);
+        for (const auto &pool : _component_pools) {
+            if (pool) {
+                pool->flush();
+            }
+        }
+        _entity_ids.clear();
+        _entity_component_signatures.clear();
+        _entity_changed.clear();
+        _free_ids.clear();
+        _entity_counter = 0;
+        return false;
+    }};
+    Id entity_count{0};
+    if (!read_value(reader, entity_count) || entity_count > MAX_ENTITIES) {
+        return fail("invalid entity count");
+    }
+    _entity_ids.resize(entity_count);
+    _entity_component_signatures.resize(entity_count);
+    _entity_changed.assign(entity_count, false);
+    Id free_count{0};
+    if (!reader.read(_entity_ids.data(), entity_count * sizeof(Id)) ||
+        !reader.read(_entity_component_signatures.data(),
+                     entity_count * sizeof(ComponentSignature)) ||
+        !read_value(reader, free_count) || free_count > entity_count) {
+        return fail("invalid entity tables");
+    }
+    /* every slot holds its own entity or a destroyed one */
+    for (Id index = 0; index < entity_count; index++) {
+        const Id stored{entity_index(_entity_ids[index])};
+        if (stored != index && stored != ENTITY_INDEX_MASK) {
+            return fail("invalid entity tables");
+        }
+    }
+    std::vector<Id> free_ids(free_count);
+    if (!reader.read(free_ids.data(), free_count * sizeof(Id))) {
+        return fail("invalid free list");
+    }
+    /* only destroyed slots can be free, each of them once */
+    std::vector<bool> is_free(entity_count, false);
+    for (const Id index : free_ids) {
+        if (index >= entity_count || is_free[index] ||
+            entity_index(_entity_ids[index]) == index) {
+            return fail("invalid free list");
+        }
+        is_free[index] = true;
+    }
+    _free_ids.assign(free_ids.begin(), free_ids.end());
+    _entity_counter = entity_count;
+    Id pool_count{0};
+    if (!read_value(reader, pool_count)) {
+        return fail("missing pools");
+    }
+    /* serializers rebind the entities held by components to it */
+    reader.registry = this;
+    for (Id i = 0; i < pool_count; i++) {
+        Id component_id{INVALID_ID};
+        if (!read_value(reader, component_id)) {
+            return fail("missing pool");
+        }
+        if (component_id >= _component_pools.size() ||
+            !_component_pools[component_id]) {
+            spdlog::error("no pool for component {0:d}, see "
+                          "register_components",
+                          component_id);
+            return fail("unknown component");
+        }
+        if (!_component_pools[component_id]->read(reader, _entity_ids)) {
+            return fail("invalid pool");
+        }
+    }
+    /* the signature of every entity must match the pools it is in */
+    for (Id index = 0; index < entity_count; index++) {
+        const Id entity_id{_entity_ids[index]};
+        const bool is_alive{entity_index(entity_id) == index};
+        if (!is_alive && _entity_component_signatures[index].any()) {
+            return fail("signature of a destroyed entity");
+        }
+        for (Id component_id = 0;
+             is_alive && component_id < _component_pools.size();
+             component_id++) {
+            const auto &pool{_component_pools[component_id]};
+            if (pool && pool->contains(entity_id) !=
+                            _entity_component_signatures[index].test(
+                                component_id)) {
+                return fail("signature does not match pools");
+            }
+        }
+    }
+    /* systems, queries and groups take every entity back in one pass */
+    const Id disabled_id{Component<Disabled>::get_id()};
+    for (Id index = 0; index < entity_count; index++) {
+        Entity entity{_entity_ids[index]};
+        if (entity.get_index() != index) {
+            continue;
+        }
+        entity.registry = this;
+        if (_entity_component_signatures[index].test(disabled_id)) {
+            _disabled_count++;
+        }
+        _update_entity_systems(entity);
+        for (const auto &group : _groups) {
+            group.second->on_added(entity.get_id());
+        }
+        _observe_components(ComponentEvent::construct, entity);
+    }
+    spdlog::debug("restored snapshot of {0:d} entity slots and {1:d} pools",
+                  entity_count, pool_count);
+    _dispatch_observers();
+    return true;
 }
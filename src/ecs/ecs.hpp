@@ -3,50 +3,33 @@
 
 #include <spdlog/spdlog.h>
 
-#include <atomic>
-#include <bitset>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <set>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <typeindex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
-namespace debby::ecs {
-/* Universal ID type */
-using Id = unsigned int;
-
-/* Thread-safe ID counter */
-using IdCounter = std::atomic<Id>;
-
-/* Max number of components an entity can have */
-constexpr unsigned int MAX_COMPONENTS{32};
-
-/* Describes which component(s) are enabled on an entity */
-typedef std::bitset<MAX_COMPONENTS> ComponentSignature;
-
-/*
- * IComponent is a simple wrapper to hold an ID counter */
-class IComponent {
-   protected:
-    static IdCounter _next_id;
-};
-
-/*
- * Component is an abstract class instantiated
- * for once for each unique component subtype */
-template <typename>
-class Component : public IComponent {
-   public:
-    inline static Id get_id() {
-        /* Since a unique component class is made for each type
-         * static id variable will only be created once per instance */
-        static IdCounter id{_next_id++};
-        return id.load();
-    }
-};
+#include "./archetype.hpp"
+#include "./arena.hpp"
+#include "./snapshot.hpp"
+#include "./types.hpp"
 
+namespace debby::ecs {
 /*
  * Entity is effectively just an identifier used by a system
  * and registry to register components and process behavior */
@@ -60,9 +43,20 @@ class Entity {
     explicit Entity(Id id);
     ~Entity() = default;
 
+    /* Packed index and generation, unique among all handles */
     [[nodiscard]] Id get_id() const;
+
+    [[nodiscard]] Id get_index() const;
+    [[nodiscard]] Id get_generation() const;
+
     void kill();
 
+    /* Disabled entities keep their components but are skipped by
+     * systems and views, which takes effect on the next update */
+    void set_enabled(bool enabled);
+
+    [[nodiscard]] bool is_enabled() const;
+
     bool operator==(const Entity &other) const;
     bool operator!=(const Entity &other) const;
     bool operator<(const Entity &other) const;
@@ -81,208 +75,2165 @@ class Entity {
     TComponent &get_component() const;
 };
 
+/* How a system accesses a component it requires */
+enum class Access { read, write };
+
+/* Stages of a frame, the systems of each phase run in the order they
+ * were added to the registry */
+enum class Phase : std::uint8_t { input, simulate, render };
+
+constexpr std::size_t PHASE_COUNT{3};
+
 /*
  * System processes entities that
  * contain a specific signature */
 class System {
    private:
     ComponentSignature _signature;
+
+    /* Components entities of the system must not have */
+    ComponentSignature _exclusions;
+
+    /* Components the system reads and writes, which
+     * determine which systems may run concurrently */
+    ComponentSignature _reads;
+    ComponentSignature _writes;
     std::vector<Entity> _entities;
 
+    /* Index is entity index, value is slot in _entities */
+    std::vector<Id> _entity_slots;
+
+    /* Bumped whenever an entity joins or leaves the system */
+    std::size_t _membership_version;
+
+    /* Registry tick when the system last began running */
+    Tick _last_run;
+
+    Phase _phase;
+    bool _is_enabled;
+
    public:
-    System() = default;
-    ~System() = default;
+    /* Registry the system was added to, such that
+     * systems can walk component pools directly */
+    class Registry *registry;
+
+    System()
+        : _membership_version(0),
+          _last_run(0),
+          _phase(Phase::simulate),
+          _is_enabled(true),
+          registry(nullptr) {}
+    virtual ~System() = default;
+
+    /* Runs the system once, called by Registry::run_systems */
+    virtual void update(float delta_time) {}
+
+    [[nodiscard]] inline Phase get_phase() const { return _phase; }
+
+    /* Must be set before the system is added to a registry */
+    inline void set_phase(Phase phase) { _phase = phase; }
+
+    [[nodiscard]] inline bool is_enabled() const { return _is_enabled; }
+
+    /* Disabled systems keep their entities up to date but are skipped
+     * by Registry::run_systems and the scheduler */
+    inline void set_enabled(bool enabled) { _is_enabled = enabled; }
 
     [[nodiscard]] const ComponentSignature &get_signature() const;
 
+    [[nodiscard]] inline const ComponentSignature &get_exclusions() const {
+        return _exclusions;
+    }
+
+    [[nodiscard]] inline const ComponentSignature &get_reads() const {
+        return _reads;
+    }
+
+    [[nodiscard]] inline const ComponentSignature &get_writes() const {
+        return _writes;
+    }
+
+    /* Whether the systems must not run concurrently, i.e. one of them
+     * writes a component that the other one reads or writes */
+    [[nodiscard]] bool conflicts_with(const System &other) const;
+
     [[nodiscard]] const std::vector<Entity> &get_entities() const;
 
+    /* Equal between two calls when no entity joined or left in between,
+     * such that systems can skip refreshing data kept per entity */
+    [[nodiscard]] inline std::size_t get_membership_version() const {
+        return _membership_version;
+    }
+
+    [[nodiscard]] inline bool has_entity(Entity entity) const {
+        const Id index{entity.get_index()};
+        return index < _entity_slots.size() &&
+               _entity_slots[index] != INVALID_ID &&
+               _entities[_entity_slots[index]] == entity;
+    }
+
+    [[nodiscard]] inline Tick get_last_run() const { return _last_run; }
+
+    /* Called at the start of a run, returns the tick of the previous
+     * run such that views can be filtered by what changed since */
+    Tick begin_run();
+
+    [[nodiscard]] MemoryUsage get_memory_usage() const;
+
+    void compact();
+
     void add_entity(Entity entity);
 
+    /* Removes every entity from the system at once */
+    void clear_entities();
+
+    /* Moves the last entity into the slot of the removed one,
+     * so the order of get_entities() is not preserved */
     void remove_entity(Entity entity);
 
-    /* Defines the component that an entity must have
-     * in order to be considered by the system */
+    /* Defines the component that an entity must have in order to be
+     * considered by the system, and how the system will access it */
     template <typename TComponent>
-    inline void require_component() {
+    inline void require_component(Access access = Access::write) {
         const Id component_id{Component<TComponent>::get_id()};
         _signature.set(component_id);
+        if (access == Access::write) {
+            _writes.set(component_id);
+        } else {
+            _reads.set(component_id);
+        }
+    }
+
+    /* Declares access to a component without requiring entities to
+     * have it, such as reading the component of another entity */
+    template <typename TComponent>
+    inline void access_component(Access access = Access::read) {
+        const Id component_id{Component<TComponent>::get_id()};
+        if (access == Access::write) {
+            _writes.set(component_id);
+        } else {
+            _reads.set(component_id);
+        }
+    }
+
+    /* Declares access to a resource of the registry, which is
+     * scheduled the same way as access to a component */
+    template <typename TResource>
+    inline void access_resource(Access access = Access::read) {
+        access_component<TResource>(access);
+    }
+
+    /* Keeps entities that have TComponent out of the system */
+    template <typename TComponent>
+    inline void exclude_component() {
+        _exclusions.set(Component<TComponent>::get_id());
+    }
+
+    /* Same as require_component for every component of the signature,
+     * for signatures only known at runtime */
+    inline void require_components(const ComponentSignature &signature,
+                                   Access access = Access::write) {
+        _signature |= signature;
+        if (access == Access::write) {
+            _writes |= signature;
+        } else {
+            _reads |= signature;
+        }
+    }
+
+    /* Same as exclude_component for every component of the signature */
+    inline void exclude_components(const ComponentSignature &signature) {
+        _exclusions |= signature;
+    }
+};
+
+/*
+ * Query is a handle to a set of entities cached by the registry,
+ * holding every entity that has all of the included and none of the
+ * excluded components. Registry::update() keeps the set up to date
+ * the same way it does for systems, so going through the entities
+ * costs O(matches). The set is shared by every handle to the same
+ * query and dropped by the first update after the last handle is */
+class Query {
+   private:
+    std::shared_ptr<const System> _cache;
+
+   public:
+    Query() : _cache(nullptr) {}
+    explicit Query(std::shared_ptr<const System> cache)
+        : _cache(std::move(cache)) {}
+
+    [[nodiscard]] inline bool is_valid() const { return _cache != nullptr; }
+
+    [[nodiscard]] inline const std::vector<Entity> &get_entities() const {
+        assert(is_valid());
+        return _cache->get_entities();
+    }
+
+    [[nodiscard]] inline std::size_t get_size() const {
+        return get_entities().size();
+    }
+
+    [[nodiscard]] inline bool contains(Entity entity) const {
+        assert(is_valid());
+        return _cache->has_entity(entity);
+    }
+
+    [[nodiscard]] inline auto begin() const {
+        return get_entities().begin();
     }
+
+    [[nodiscard]] inline auto end() const { return get_entities().end(); }
+};
+
+/*
+ * IGroup is notified whenever a component is added to or about to be
+ * removed from a pool the group owns, such that it can keep the
+ * entities having every owned component packed together */
+class IGroup {
+   public:
+    virtual ~IGroup() = default;
+
+    virtual void on_added(Id entity_id) = 0;
+
+    virtual void on_removed(Id entity_id) = 0;
+
+    /* Called once every pool of the group has been flushed */
+    virtual void on_cleared() = 0;
 };
 
 /*
  * IPool is just a simple interface that can be used
  * when the T used in Pool is not known precisely */
 class IPool {
+   private:
+    /* Group that decides the order of the pool, if any */
+    IGroup *_group = nullptr;
+
    public:
     virtual ~IPool() = default;
+
+    [[nodiscard]] inline IGroup *get_group() const { return _group; }
+
+    inline void set_group(IGroup *group) { _group = group; }
+
+    [[nodiscard]] virtual bool contains(Id entity_id) const = 0;
+
+    virtual void remove(Id entity_id) = 0;
+
+    [[nodiscard]] virtual MemoryUsage get_memory_usage() const = 0;
+
+    /* Releases memory not needed by the components left in the pool */
+    virtual void compact() = 0;
+
+    /* Destroys every component and releases all of their memory */
+    virtual void flush() = 0;
+
+    /* Gives each of count entities, none of which may have the
+     * component yet, a copy of the component at prototype */
+    virtual void append(const void *prototype, const Id *entity_ids,
+                        std::size_t count) = 0;
+
+    /* Writes the components and their owners, returns false if the
+     * component can not be part of a snapshot or the write failed */
+    [[nodiscard]] virtual bool write(SnapshotWriter &writer) const = 0;
+
+    /* Replaces the pool with components written by write(), which
+     * are stamped as added at the current tick. Fails unless every
+     * owner is alive in entity_ids, the restored entity table */
+    [[nodiscard]] virtual bool read(SnapshotReader &reader,
+                                    const std::vector<Id> &entity_ids) = 0;
+
+    /* Appends every entity whose component changed after since,
+     * except those whose component was also added after it */
+    virtual void collect_changed(Tick since,
+                                 std::vector<Id> &entity_ids) const = 0;
 };
 
 /*
- * Pool is a vector wrapper of type T objects */
+ * Pool is a sparse set of type T objects. The sparse index maps
+ * an entity id to a slot in the dense arrays, which hold the
+ * components and their owning entity ids packed together, such
+ * that iteration only ever touches live components. Components
+ * live in fixed-size pages taken from the arena of the registry,
+ * so growing the pool never moves the components already in it */
 template <typename T>
-class Pool : public IPool {
+class Pool final : public IPool {
    private:
-    std::vector<T> _data;
+    static_assert(sizeof(T) <= ARENA_PAGE_SIZE,
+                  "component does not fit in an arena page");
+    static_assert(alignof(T) <= ARENA_PAGE_ALIGNMENT,
+                  "component is aligned beyond an arena page");
+
+    /* Index is entity index, value is slot in dense arrays */
+    std::vector<Id> _sparse;
+
+    /* Packed components, their owners and ticks, kept in lockstep */
+    std::vector<T *> _pages;
+    std::vector<Id> _entities;
+    std::vector<ComponentTicks> _ticks;
+    Id _size;
+
+    Arena *_arena;
+
+    /* Tick of the owning registry, components are stamped with it */
+    const TickCounter *_clock;
+
+    [[nodiscard]] inline Tick _now() const {
+        return _clock ? _clock->load(std::memory_order_relaxed) : 0;
+    }
+
+    [[nodiscard]] inline T *_address(Id slot) const {
+        return _pages[slot / PAGE_CAPACITY] + slot % PAGE_CAPACITY;
+    }
+
+    /* Takes pages from the arena until count components fit */
+    inline void _grow(std::size_t count) {
+        while (_pages.size() * PAGE_CAPACITY < count) {
+            _pages.push_back(static_cast<T *>(_arena->allocate()));
+        }
+    }
+
+    /* Returns the pages from first onwards to the arena */
+    inline void _release_pages(std::size_t first) {
+        while (_pages.size() > first) {
+            _arena->release(_pages.back());
+            _pages.pop_back();
+        }
+    }
+
+    inline void _destroy_items() {
+        for (Id slot = 0; slot < _size; slot++) {
+            _address(slot)->~T();
+        }
+        _size = 0;
+    }
 
    public:
-    explicit Pool(unsigned int size = 100) { _data.resize(size); }
+    /* Number of components in each page */
+    static constexpr Id PAGE_CAPACITY{
+        static_cast<Id>(ARENA_PAGE_SIZE / sizeof(T))};
+
+    /* No page is taken from the arena until the first component is
+     * added, unless capacity asks for room up front, such that pools
+     * of rarely used components cost nothing while they stay empty */
+    explicit Pool(Arena &arena, const TickCounter *clock = nullptr,
+                  unsigned int capacity = 0)
+        : _size(0), _arena(&arena), _clock(clock) {
+        reserve(capacity);
+    }
+
+    ~Pool() override {
+        _destroy_items();
+        _release_pages(0);
+    }
+
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+
+    [[nodiscard]] inline bool is_empty() const { return _size == 0; }
+
+    [[nodiscard]] inline unsigned int get_size() const { return _size; }
+
+    /* Also compares generations, such that a stale entity
+     * never matches the component of a recycled index */
+    [[nodiscard]] inline bool contains(Id entity_id) const override {
+        const Id index{entity_index(entity_id)};
+        return index < _sparse.size() && _sparse[index] != INVALID_ID &&
+               _entities[_sparse[index]] == entity_id;
+    }
+
+    inline void flush() override {
+        _destroy_items();
+        _release_pages(0);
+        _sparse.clear();
+        _entities.clear();
+        _ticks.clear();
+    }
 
-    ~Pool() override = default;
+    [[nodiscard]] inline MemoryUsage get_memory_usage() const override {
+        MemoryUsage usage{ecs::get_memory_usage(_sparse)};
+        usage += {_size * sizeof(T), _pages.size() * ARENA_PAGE_SIZE};
+        usage += ecs::get_memory_usage(_pages);
+        usage += ecs::get_memory_usage(_entities);
+        usage += ecs::get_memory_usage(_ticks);
+        return usage;
+    }
+
+    inline void compact() override {
+        /* trailing slots belong to entities that no longer have
+         * the component, typically the last ones to be despawned */
+        while (!_sparse.empty() && _sparse.back() == INVALID_ID) {
+            _sparse.pop_back();
+        }
+        _sparse.shrink_to_fit();
+        _release_pages((_size + PAGE_CAPACITY - 1) / PAGE_CAPACITY);
+        _pages.shrink_to_fit();
+        _entities.shrink_to_fit();
+        _ticks.shrink_to_fit();
+    }
+
+    /* Makes room for count more components without allocating */
+    inline void reserve(unsigned int count) {
+        _grow(static_cast<std::size_t>(_size) + count);
+        _entities.reserve(_entities.size() + count);
+        _ticks.reserve(_ticks.size() + count);
+    }
+
+    /* Constructs a component for the entity, replacing any component
+     * the entity already had in the pool, which counts as a change */
+    template <typename... TArgs>
+    inline T &emplace(Id entity_id, TArgs &&...args) {
+        if (contains(entity_id)) {
+            mark_changed(entity_id);
+            T &item{get_item(entity_id)};
+            item = T(std::forward<TArgs>(args)...);
+            return item;
+        }
+        const Id index{entity_index(entity_id)};
+        if (index >= _sparse.size()) {
+            _sparse.resize(index + 1, INVALID_ID);
+        }
+        assert(_sparse[index] == INVALID_ID);
+        _grow(static_cast<std::size_t>(_size) + 1);
+        T *item{new (_address(_size)) T(std::forward<TArgs>(args)...)};
+        _sparse[index] = _size++;
+        _entities.push_back(entity_id);
+        const Tick now{_now()};
+        _ticks.push_back({now, now});
+        return *item;
+    }
+
+    /* Copies are made a page at a time, with memcpy when T is
+     * trivially copyable, and stamped as added at the same tick */
+    inline void append(const void *prototype, const Id *entity_ids,
+                       std::size_t count) override {
+        const Id first{_size};
+        const Id end{first + static_cast<Id>(count)};
+        _grow(end);
+        for (Id slot = first; slot < end;) {
+            const Id run{std::min(get_page_remaining(slot), end - slot)};
+            copy_construct_n(_address(slot),
+                             *static_cast<const T *>(prototype), run);
+            slot += run;
+        }
+        _size = end;
+        _entities.insert(_entities.end(), entity_ids, entity_ids + count);
+        const Tick now{_now()};
+        _ticks.resize(end, {now, now});
+        for (Id slot = first; slot < end; slot++) {
+            const Id index{entity_index(_entities[slot])};
+            if (index >= _sparse.size()) {
+                _sparse.resize(index + 1, INVALID_ID);
+            }
+            assert(_sparse[index] == INVALID_ID);
+            _sparse[index] = slot;
+        }
+    }
+
+    /* Trivially copyable components are written a page at a time,
+     * others one at a time through their serializer */
+    [[nodiscard]] inline bool write(SnapshotWriter &writer) const override {
+        if constexpr (!is_snapshot_v<T>) {
+            spdlog::error("{0} can not be part of a snapshot",
+                          typeid(T).name());
+            return false;
+        } else {
+            const auto item_size{static_cast<std::uint32_t>(sizeof(T))};
+            if (!write_value(writer, item_size) ||
+                !write_value(writer, _size) ||
+                !writer.write(_entities.data(), _size * sizeof(Id))) {
+                return false;
+            }
+            if constexpr (has_serializer_v<T>) {
+                for (Id slot = 0; slot < _size; slot++) {
+                    if (!debby_ecs_write(writer, at(slot))) {
+                        return false;
+                    }
+                }
+            } else {
+                for (Id slot = 0; slot < _size; slot += PAGE_CAPACITY) {
+                    const Id count{std::min(PAGE_CAPACITY, _size - slot)};
+                    if (!writer.write(_address(slot), count * sizeof(T))) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    }
+
+    [[nodiscard]] inline bool read(
+        SnapshotReader &reader, const std::vector<Id> &entity_ids) override {
+        flush();
+        if constexpr (!is_snapshot_v<T>) {
+            spdlog::error("{0} can not be part of a snapshot",
+                          typeid(T).name());
+            return false;
+        } else {
+            std::uint32_t item_size{0};
+            Id size{0};
+            if (!read_value(reader, item_size) || !read_value(reader, size)) {
+                return false;
+            }
+            if (item_size != sizeof(T)) {
+                spdlog::error("snapshot of {0} has size {1:d}, expected {2:d}",
+                              typeid(T).name(), item_size, sizeof(T));
+                return false;
+            }
+            if (size > entity_ids.size()) {
+                spdlog::error("snapshot of {0} has more components than "
+                              "entities",
+                              typeid(T).name());
+                return false;
+            }
+            _entities.resize(size);
+            if (!reader.read(_entities.data(), size * sizeof(Id))) {
+                _entities.clear();
+                return false;
+            }
+            for (Id slot = 0; slot < size; slot++) {
+                const Id index{entity_index(_entities[slot])};
+                if (index >= entity_ids.size() ||
+                    entity_ids[index] != _entities[slot] ||
+                    (index < _sparse.size() && _sparse[index] != INVALID_ID)) {
+                    spdlog::error("snapshot of {0} has an invalid owner",
+                                  typeid(T).name());
+                    flush();
+                    return false;
+                }
+                if (index >= _sparse.size()) {
+                    _sparse.resize(index + 1, INVALID_ID);
+                }
+                _sparse[index] = slot;
+            }
+            _grow(size);
+            if constexpr (has_serializer_v<T>) {
+                static_assert(std::is_default_constructible_v<T>,
+                              "serialized components are read into a "
+                              "default constructed component");
+                for (; _size < size; _size++) {
+                    T *item{new (_address(_size)) T()};
+                    if (!debby_ecs_read(reader, *item)) {
+                        item->~T();
+                        flush();
+                        return false;
+                    }
+                }
+            } else {
+                for (Id slot = 0; slot < size; slot += PAGE_CAPACITY) {
+                    const Id count{std::min(PAGE_CAPACITY, size - slot)};
+                    if (!reader.read(_address(slot), count * sizeof(T))) {
+                        flush();
+                        return false;
+                    }
+                    /* only count what has been read, for flush() */
+                    _size = slot + count;
+                }
+            }
+            const Tick now{_now()};
+            _ticks.assign(size, {now, now});
+            return true;
+        }
+    }
+
+    /* Moves the last component into the slot of the removed
+     * one, such that the dense arrays stay tightly packed */
+    inline void remove(Id entity_id) override {
+        if (!contains(entity_id)) {
+            return;
+        }
+        const Id index{_sparse[entity_index(entity_id)]};
+        const Id last{_size - 1};
+        if (index != last) {
+            at(index) = std::move(at(last));
+            _entities[index] = _entities[last];
+            _ticks[index] = _ticks[last];
+            _sparse[entity_index(_entities[index])] = index;
+        }
+        _address(last)->~T();
+        _size--;
+        _entities.pop_back();
+        _ticks.pop_back();
+        _sparse[entity_index(entity_id)] = INVALID_ID;
+    }
+
+    inline T &get_item(Id entity_id) {
+        return at(_sparse[entity_index(entity_id)]);
+    }
+
+    inline const T &get_item(Id entity_id) const {
+        return at(_sparse[entity_index(entity_id)]);
+    }
+
+    inline T &operator[](Id entity_id) { return get_item(entity_id); }
+
+    /* Dense access, slot is in [0, get_size()) */
+    inline T &at(Id slot) { return *_address(slot); }
+
+    inline const T &at(Id slot) const { return *_address(slot); }
 
-    [[nodiscard]] inline bool is_empty() const { return _data.empty(); }
+    /* Slots from slot onwards that are contiguous in memory with it,
+     * since components are only contiguous within a page */
+    [[nodiscard]] inline Id get_page_remaining(Id slot) const {
+        return PAGE_CAPACITY - slot % PAGE_CAPACITY;
+    }
+
+    /* Slot of the entity in the dense arrays */
+    [[nodiscard]] inline Id get_slot(Id entity_id) const {
+        return _sparse[entity_index(entity_id)];
+    }
 
-    [[nodiscard]] inline unsigned int get_size() const {
-        return static_cast<int>(_data.size());
+    /* Swaps two slots of the dense arrays, used by groups to
+     * keep the entities they own packed at the front */
+    inline void swap(Id a, Id b) {
+        if (a == b) {
+            return;
+        }
+        std::swap(at(a), at(b));
+        std::swap(_entities[a], _entities[b]);
+        std::swap(_ticks[a], _ticks[b]);
+        _sparse[entity_index(_entities[a])] = a;
+        _sparse[entity_index(_entities[b])] = b;
     }
 
-    inline void set_size(unsigned int new_size) { _data.resize(new_size); }
+    inline void collect_changed(Tick since,
+                                std::vector<Id> &entity_ids) const override {
+        for (std::size_t slot = 0; slot < _ticks.size(); slot++) {
+            if (_ticks[slot].changed > since && _ticks[slot].added <= since) {
+                entity_ids.push_back(_entities[slot]);
+            }
+        }
+    }
 
-    inline void flush() { _data.clear(); }
+    /* Appends every entity whose component was added or changed after
+     * since, for copies that must also see components added again */
+    inline void collect_updated(Tick since,
+                                std::vector<Id> &entity_ids) const {
+        for (std::size_t slot = 0; slot < _ticks.size(); slot++) {
+            if (_ticks[slot].changed > since) {
+                entity_ids.push_back(_entities[slot]);
+            }
+        }
+    }
 
-    inline void append(T obj) { _data.push_back(obj); }
+    [[nodiscard]] inline const ComponentTicks &get_ticks(Id entity_id) const {
+        return _ticks[_sparse[entity_index(entity_id)]];
+    }
 
-    inline void set_item(unsigned int index, T object) {
-        _data[index] = object;
+    /* Stamps the component of the entity as changed at the current tick.
+     * Safe to call concurrently as long as the entities are distinct */
+    inline void mark_changed(Id entity_id) {
+        _ticks[_sparse[entity_index(entity_id)]].changed = _now();
     }
 
-    inline T &get_item(unsigned int index) { return _data[index]; }
+    /* Reorders the dense arrays such that compare(a, b) holds for every
+     * component a before b, keeping equal components in their current
+     * order. Pools owned by a group must not be sorted */
+    template <typename TCompare>
+    inline void sort(TCompare compare) {
+        assert(!get_group());
+        std::vector<Id> order(_size);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](Id a, Id b) {
+            return compare(std::as_const(at(a)), std::as_const(at(b)));
+        });
+        /* slot i receives the component at order[i], applied
+         * one cycle at a time such that each swap is final */
+        for (Id i = 0; i < order.size(); i++) {
+            Id current{i};
+            while (order[current] != i) {
+                const Id next{order[current]};
+                swap(current, next);
+                order[current] = current;
+                current = next;
+            }
+            order[current] = current;
+        }
+    }
 
-    inline T &operator[](unsigned int index) { return _data[index]; }
+    inline const Id *get_entities() const { return _entities.data(); }
 };
 
 /*
- * Registry manages creation and destruction of entities,
- * adding systems and adding components to entities
- * */
-class Registry {
+ * View iterates every entity that has all of TComponents, yielding
+ * the entity along with references to its components. With pool
+ * storage it walks the smallest of the pools and probes the others.
+ * With archetype storage it streams through the columns of every
+ * archetype matching the components, so no probing is needed */
+template <typename... TComponents>
+class View {
    private:
-    IdCounter _entity_counter;
+    class Registry *_registry;
+    std::tuple<Pool<TComponents> *...> _pools;
 
-    /* Each pool contains all data for a certain component type.
-     * Vector index is component id and pool index is entity id */
-    std::vector<std::shared_ptr<IPool>> _component_pools;
+    /* Dense entity ids of the smallest pool, which drives iteration */
+    const Id *_entities;
+    unsigned int _size;
 
-    /* Vector of component signatures per entity.
-     * Vector index is equal to entity id */
-    std::vector<ComponentSignature> _entity_component_signatures;
+    /* Set instead of the pools when using archetype storage */
+    const std::vector<Archetype *> *_archetypes;
 
-    std::unordered_map<std::type_index, std::shared_ptr<System>> _systems;
+    /* Ticks each component must have been added or changed after, in
+     * the order of TComponents. Zero matches every component */
+    std::array<Tick, sizeof...(TComponents)> _added_since;
+    std::array<Tick, sizeof...(TComponents)> _changed_since;
+    bool _is_filtered;
 
-    /* Save entities to add/remove, such that they can
-     * be processed in bulk at the end of each frame */
-    std::set<Entity> _entities_add_queue;
-    std::set<Entity> _entities_remove_queue;
+    /* Components (typically tags) entities must also have or must not
+     * have, checked against the signatures of the registry */
+    const std::vector<ComponentSignature> *_signatures;
+    ComponentSignature _with;
+    ComponentSignature _without;
+    bool _is_tag_filtered;
 
-    /* Saves the Id of a destroyed entity such that
-     * it can be reused for other new entities */
-    std::deque<Id> _free_ids;
+    static_assert(!(is_tag_v<TComponents> || ...),
+                  "tags hold no data, filter by them with with<TTag>()");
 
-    /* Add entity to systems where the component signature is set */
-    void _add_entity_to_systems(Entity entity);
+    template <typename TComponent>
+    [[nodiscard]] static constexpr std::size_t _index_of() {
+        constexpr bool matches[]{std::is_same_v<TComponent, TComponents>...};
+        for (std::size_t i = 0; i < sizeof...(TComponents); i++) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return sizeof...(TComponents);
+    }
 
-    /* Remove entity from systems */
-    void _remove_entity_from_systems(Entity entity);
+    template <typename TComponent>
+    [[nodiscard]] inline bool _passes_filter(Id entity_id) const {
+        constexpr std::size_t i{_index_of<TComponent>()};
+        const ComponentTicks &ticks{
+            std::get<Pool<TComponent> *>(_pools)->get_ticks(entity_id)};
+        return ticks.added > _added_since[i] &&
+               ticks.changed > _changed_since[i];
+    }
 
-   public:
-    Registry();
-    ~Registry() = default;
+    [[nodiscard]] inline bool _passes_tags(Id entity_id) const {
+        const ComponentSignature &signature{
+            (*_signatures)[entity_index(entity_id)]};
+        return signature.contains(_with) && !signature.intersects(_without);
+    }
 
-    void update();
+    [[nodiscard]] inline bool _matches(Id entity_id) const {
+        if (!(std::get<Pool<TComponents> *>(_pools)->contains(entity_id) &&
+              ...)) {
+            return false;
+        }
+        if (_is_tag_filtered && !_passes_tags(entity_id)) {
+            return false;
+        }
+        return !_is_filtered || (_passes_filter<TComponents>(entity_id) && ...);
+    }
 
-    Entity create_entity();
-    void destroy_entity(Entity entity);
+    [[nodiscard]] inline Entity _make_entity(Id entity_id) const {
+        Entity entity{entity_id};
+        entity.registry = _registry;
+        return entity;
+    }
 
-    template <typename TComponent, typename... TComponentArgs>
-    inline TComponent &add_component(Entity entity, TComponentArgs &&...args) {
-        const Id component_id{Component<TComponent>::get_id()};
-        if (component_id >=
-            static_cast<unsigned int>(_component_pools.size())) {
-            /* Resize by one, since the resizing should be rare
-             * so using the default vector resize could be expensive */
-            _component_pools.resize(component_id + 1, nullptr);
+   public:
+    class Iterator {
+       private:
+        const View *_view;
+
+        /* Archetype and row, or just the dense index for pools */
+        std::size_t _archetype;
+        unsigned int _index;
+
+        inline void _skip_missing() {
+            if (_view->_archetypes) {
+                const auto &archetypes{*_view->_archetypes};
+                while (_archetype < archetypes.size()) {
+                    const Archetype &archetype{*archetypes[_archetype]};
+                    if (_index >= archetype.get_size()) {
+                        _archetype++;
+                        _index = 0;
+                    } else if (_view->_is_tag_filtered &&
+                               !_view->_passes_tags(
+                                   archetype.get_entity(_index))) {
+                        _index++;
+                    } else {
+                        break;
+                    }
+                }
+                return;
+            }
+            while (_index < _view->_size &&
+                   !_view->_matches(_view->_entities[_index])) {
+                _index++;
+            }
         }
-        if (!_component_pools[component_id]) {
-            _component_pools[component_id] =
-                std::make_shared<Pool<TComponent>>();
+
+       public:
+        Iterator(const View *view, std::size_t archetype, unsigned int index)
+            : _view(view), _archetype(archetype), _index(index) {
+            _skip_missing();
         }
-        std::shared_ptr<Pool<TComponent>> component_pool{
-            std::static_pointer_cast<Pool<TComponent>>(
-                _component_pools[component_id])};
-        const Id entity_id{entity.get_id()};
-        if (entity_id >= component_pool->get_size()) {
-            component_pool->set_size(_entity_counter.load());
+
+        inline std::tuple<Entity, TComponents &...> operator*() const {
+            if (_view->_archetypes) {
+                const Archetype &archetype{
+                    *(*_view->_archetypes)[_archetype]};
+                return std::tuple<Entity, TComponents &...>(
+                    _view->_make_entity(archetype.get_entity(_index)),
+                    archetype.get_item<TComponents>(_index)...);
+            }
+            const Id entity_id{_view->_entities[_index]};
+            return std::tuple<Entity, TComponents &...>(
+                _view->_make_entity(entity_id),
+                std::get<Pool<TComponents> *>(_view->_pools)
+                    ->get_item(entity_id)...);
         }
 
-        spdlog::trace("adding {0} to entity {1:d}", typeid(TComponent).name(),
-                      entity_id);
+        inline Iterator &operator++() {
+            _index++;
+            _skip_missing();
+            return *this;
+        }
 
-        TComponent new_component(std::forward<TComponentArgs>(args)...);
-        component_pool->set_item(entity_id, new_component);
-        _entity_component_signatures[entity_id].set(component_id);
-        return component_pool->get_item(entity_id);
-    }
+        inline bool operator==(const Iterator &other) const {
+            return _archetype == other._archetype && _index == other._index;
+        }
 
-    template <typename TComponent>
-    inline void remove_component(Entity entity) {
-        const Id component_id{Component<TComponent>::get_id()};
-        const Id entity_id{entity.get_id()};
+        inline bool operator!=(const Iterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    View(class Registry *registry,
+         const std::vector<ComponentSignature> *signatures,
+         const ComponentSignature &without, Pool<TComponents> *...pools)
+        : _registry(registry),
+          _pools(pools...),
+          _entities(nullptr),
+          _size(0),
+          _archetypes(nullptr),
+          _added_since({}),
+          _changed_since({}),
+          _is_filtered(false),
+          _signatures(signatures),
+          _with(),
+          _without(without),
+          _is_tag_filtered(without.any()) {
+        if (((pools == nullptr) || ...)) {
+            /* some component was never added, so nothing can match */
+            return;
+        }
+        _size = std::numeric_limits<unsigned int>::max();
+        auto pick_smallest{[this](auto *pool) {
+            if (pool->get_size() < _size) {
+                _entities = pool->get_entities();
+                _size = pool->get_size();
+            }
+        }};
+        (pick_smallest(pools), ...);
+    }
 
-        spdlog::trace("removing {0} from entity {1:d}",
-                      typeid(TComponent).name(), entity_id);
+    View(class Registry *registry,
+         const std::vector<ComponentSignature> *signatures,
+         const ComponentSignature &without,
+         const std::vector<Archetype *> *archetypes)
+        : _registry(registry),
+          _pools(),
+          _entities(nullptr),
+          _size(0),
+          _archetypes(archetypes),
+          _added_since({}),
+          _changed_since({}),
+          _is_filtered(false),
+          _signatures(signatures),
+          _with(),
+          _without(without),
+          _is_tag_filtered(without.any()) {
+        for (const Archetype *archetype : *archetypes) {
+            _size += archetype->get_size();
+        }
+    }
 
-        _entity_component_signatures[entity_id].set(component_id, false);
+    /* Only yields entities whose TComponent was added after since.
+     * Ticks are not tracked with archetype storage, where every
+     * component is considered added and changed */
+    template <typename TComponent>
+    [[nodiscard]] inline View added(Tick since) const {
+        static_assert(_index_of<TComponent>() < sizeof...(TComponents),
+                      "filtered component must be part of the view");
+        View view{*this};
+        view._added_since[_index_of<TComponent>()] = since;
+        view._is_filtered = true;
+        return view;
     }
 
+    /* Only yields entities whose TComponent was changed after since,
+     * where adding a component also counts as changing it */
     template <typename TComponent>
-    inline bool has_component(Entity entity) const {
-        const Id component_id{Component<TComponent>::get_id()};
-        const Id entity_id{entity.get_id()};
-        return _entity_component_signatures[entity_id].test(component_id);
+    [[nodiscard]] inline View changed(Tick since) const {
+        static_assert(_index_of<TComponent>() < sizeof...(TComponents),
+                      "filtered component must be part of the view");
+        View view{*this};
+        view._changed_since[_index_of<TComponent>()] = since;
+        view._is_filtered = true;
+        return view;
     }
 
+    /* Only yields entities that also have TComponent, typically a tag */
     template <typename TComponent>
-    inline TComponent &get_component(Entity entity) const {
-        const Id component_id{Component<TComponent>::get_id()};
-        const Id entity_id{entity.get_id()};
-        auto pool{std::static_pointer_cast<Pool<TComponent>>(
-            _component_pools[component_id])};
-        return pool->get_item(entity_id);
+    [[nodiscard]] inline View with() const {
+        View view{*this};
+        view._with.set(Component<TComponent>::get_id());
+        view._is_tag_filtered = true;
+        return view;
     }
 
-    template <typename TSystem, typename... TSystemArgs>
-    inline void add_system(TSystemArgs &&...args) {
-        std::shared_ptr<TSystem> new_system(
-            std::make_shared<TSystem>(std::forward<TSystemArgs>(args)...));
-        _systems.insert(
-            std::make_pair(std::type_index(typeid(TSystem)), new_system));
+    /* Only yields entities that do not have TComponent */
+    template <typename TComponent>
+    [[nodiscard]] inline View without() const {
+        View view{*this};
+        view._without.set(Component<TComponent>::get_id());
+        view._is_tag_filtered = true;
+        return view;
     }
 
-    template <typename TSystem>
-    inline void remove_system() {
-        const auto system{_systems.find(std::type_index(typeid(TSystem)))};
-        if (system == _systems.end()) {
-            spdlog::warn("tried to remove non-existent {0} from registry",
-                         typeid(TSystem).name());
-            return;
+    /* Upper bound on the number of entities the view yields */
+    [[nodiscard]] inline unsigned int size_hint() const { return _size; }
+
+    [[nodiscard]] inline Iterator begin() const { return {this, 0, 0}; }
+
+    [[nodiscard]] inline Iterator end() const {
+        if (_archetypes) {
+            return {this, _archetypes->size(), 0};
         }
-        spdlog::debug("removing {0} from registry", system->first.name());
-        _systems.erase(system);
+        return {this, 0, _size};
     }
 
-    template <typename TSystem>
-    inline bool has_system() const {
-        const auto system{_systems.find(std::type_index(typeid(TSystem)))};
-        return system != _systems.end();
+    /* Calls fn(entity, components...) for each matching entity */
+    template <typename TFunc>
+    inline void each(TFunc &&fn) const {
+        each(0, _size, fn);
     }
 
-    template <typename TSystem>
-    inline TSystem &get_system() const {
-        const auto system{_systems.find(std::type_index(typeid(TSystem)))};
-        return *(std::static_pointer_cast<TSystem>(system->second));
+    /* Same as above, limited to the entities within [first, last) of
+     * size_hint(), such that disjoint ranges may run in parallel */
+    template <typename TFunc>
+    inline void each(std::size_t first, std::size_t last, TFunc &&fn) const {
+        if (_archetypes) {
+            /* ranges count rows across archetypes in query order */
+            std::size_t base{0};
+            for (const Archetype *archetype : *_archetypes) {
+                const std::size_t size{archetype->get_size()};
+                if (base >= last) {
+                    break;
+                }
+                if (base + size <= first) {
+                    base += size;
+                    continue;
+                }
+                Id row{static_cast<Id>(std::max(first, base) - base)};
+                const Id end_row{
+                    static_cast<Id>(std::min(last, base + size) - base)};
+                const Id capacity{archetype->get_chunk_capacity()};
+                while (row < end_row) {
+                    const Id chunk{row / capacity};
+                    const Id *entities{archetype->get_entities(chunk)};
+                    std::tuple<TComponents *...> columns{
+                        archetype->get_column<TComponents>(chunk)...};
+                    const Id chunk_end{
+                        std::min(end_row, (chunk + 1) * capacity)};
+                    for (; row < chunk_end; row++) {
+                        const Id slot{row - chunk * capacity};
+                        if (_is_tag_filtered &&
+                            !_passes_tags(entities[slot])) {
+                            continue;
+                        }
+                        fn(_make_entity(entities[slot]),
+                           std::get<TComponents *>(columns)[slot]...);
+                    }
+                }
+                base += size;
+            }
+            return;
+        }
+        for (std::size_t i = first; i < last; i++) {
+            const Id entity_id{_entities[i]};
+            if (!_matches(entity_id)) {
+                continue;
+            }
+            fn(_make_entity(entity_id),
+               std::get<Pool<TComponents> *>(_pools)->get_item(entity_id)...);
+        }
     }
 };
 
+/*
+ * Group owns the pools of TComponents and keeps every entity that has
+ * all of them packed at the front of each pool, in the same order.
+ * Iterating a group is therefore a lockstep walk over parallel arrays
+ * without probing any pool. A pool can only be owned by one group */
+template <typename... TComponents>
+class Group final : public IGroup {
+   private:
+    class Registry *_registry;
+    std::tuple<Pool<TComponents> *...> _pools;
+
+    /* Entities in [0, _size) of every pool belong to the group */
+    unsigned int _size;
+
+    /* Groups only manage pools, with archetype storage they
+     * fall back to a view since archetypes are packed already */
+    bool _is_owning;
+
+    using TFirst = std::tuple_element_t<0, std::tuple<TComponents...>>;
+
+    static_assert(!(is_tag_v<TComponents> || ...),
+                  "tags hold no data and cannot be owned by a group");
+
+   public:
+    Group(class Registry *registry, Pool<TComponents> *...pools)
+        : _registry(registry),
+          _pools(pools...),
+          _size(0),
+          _is_owning(((pools != nullptr) && ...)) {}
+
+    ~Group() override = default;
+
+    Group(const Group &) = delete;
+    Group &operator=(const Group &) = delete;
+
+    [[nodiscard]] inline unsigned int get_size() const { return _size; }
+
+    /* Upper bound on the number of entities the group yields */
+    [[nodiscard]] unsigned int size_hint() const;
+
+    /* Component of the group at index in [0, get_size()) */
+    template <typename TComponent>
+    [[nodiscard]] inline TComponent &at(Id index) const {
+        return std::get<Pool<TComponent> *>(_pools)->at(index);
+    }
+
+    [[nodiscard]] inline const Id *get_entities() const {
+        return std::get<Pool<TFirst> *>(_pools)->get_entities();
+    }
+
+    inline void on_added(Id entity_id) override {
+        if (!(std::get<Pool<TComponents> *>(_pools)->contains(entity_id) &&
+              ...)) {
+            return;
+        }
+        if (std::get<Pool<TFirst> *>(_pools)->get_slot(entity_id) < _size) {
+            return;
+        }
+        (std::get<Pool<TComponents> *>(_pools)->swap(
+             std::get<Pool<TComponents> *>(_pools)->get_slot(entity_id),
+             _size),
+         ...);
+        _size++;
+    }
+
+    inline void on_removed(Id entity_id) override {
+        const Pool<TFirst> *first{std::get<Pool<TFirst> *>(_pools)};
+        if (!first->contains(entity_id) ||
+            first->get_slot(entity_id) >= _size) {
+            return;
+        }
+        _size--;
+        (std::get<Pool<TComponents> *>(_pools)->swap(
+             std::get<Pool<TComponents> *>(_pools)->get_slot(entity_id),
+             _size),
+         ...);
+    }
+
+    inline void on_cleared() override { _size = 0; }
+
+    /* Calls fn(entity, components...) for each entity in the group */
+    template <typename TFunc>
+    inline void each(TFunc &&fn) const {
+        each(0, size_hint(), fn);
+    }
+
+    /* Same as above, limited to the entities within [first, last) of
+     * size_hint(), such that disjoint ranges may run in parallel */
+    template <typename TFunc>
+    void each(std::size_t first, std::size_t last, TFunc &&fn) const;
+};
+
+/* Lifecycle events of a component that observers are told about */
+enum class ComponentEvent : std::uint8_t { construct, update, destroy };
+
+constexpr std::size_t COMPONENT_EVENT_COUNT{3};
+
+/* Receives every entity an event happened to since the last update */
+using ObserverCallback = std::function<void(const std::vector<Entity> &)>;
+
+/* Selects how a registry lays out component data in memory */
+enum class Storage {
+    /* One sparse set per component type */
+    pools,
+    /* Entities grouped by signature into chunks of component columns */
+    archetypes
+};
+
+/*
+ * CommandBuffer records structural changes (creating and destroying
+ * entities, adding and removing components) such that they can be
+ * made from any thread while systems run. Commands are stored in
+ * linear pages of memory and played back by Registry::update(), where
+ * the commands of every buffer are merged by sort key, then by the
+ * order they were recorded in. Recording work under a key that is
+ * unique to the work (e.g. the entity being processed) therefore
+ * makes the merged order independent of which thread did the work */
+class CommandBuffer {
+   private:
+    enum class CommandType : std::uint8_t { create, destroy, add, remove };
+
+    /* Header of a command, followed by its payload in the same page */
+    struct Command {
+        void (*apply)(class Registry &registry, Entity entity, void *payload);
+        void (*release)(void *payload);
+        void *payload;
+        std::uint64_t key;
+        Id entity_id;
+        Id sequence;
+        std::uint32_t size;
+        CommandType type;
+    };
+
+    struct Page {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+        std::size_t capacity;
+    };
+
+    /* Size of each page, larger payloads get a page of their own */
+    static constexpr std::size_t PAGE_SIZE{16 * 1024};
+
+    class Registry *_registry;
+    std::vector<Page> _pages;
+
+    /* Page currently being written to */
+    std::size_t _page;
+
+    std::uint64_t _key;
+    Id _sequence;
+
+    Command &_push(CommandType type, Entity entity,
+                   std::size_t payload_size = 0,
+                   std::size_t payload_alignment = 1);
+
+    /* Destroys every command, without releasing reserved entities
+     * since those are alive once the buffer has been played back */
+    void _reset();
+
+    template <typename TFunc>
+    inline void _for_each(TFunc &&fn) {
+        for (std::size_t i = 0; i <= _page && i < _pages.size(); i++) {
+            std::size_t offset{0};
+            while (offset < _pages[i].size) {
+                auto *command{
+                    reinterpret_cast<Command *>(_pages[i].data.get() + offset)};
+                offset += command->size;
+                fn(*command);
+            }
+        }
+    }
+
+    friend class Registry;
+
+   public:
+    explicit CommandBuffer(class Registry *registry);
+    ~CommandBuffer();
+
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+
+    [[nodiscard]] inline bool is_empty() const {
+        return _sequence == 0;
+    }
+
+    /* Key every following command is merged by */
+    inline void set_sort_key(std::uint64_t key) { _key = key; }
+
+    /* Reserves an entity that comes alive once the buffer is played
+     * back, it may only be used with this buffer until then */
+    Entity create_entity();
+
+    void destroy_entity(Entity entity);
+
+    /* The component is constructed right away and moved
+     * into the registry when the buffer is played back */
+    template <typename TComponent, typename... TComponentArgs>
+    void add_component(Entity entity, TComponentArgs &&...args);
+
+    template <typename TComponent>
+    void remove_component(Entity entity);
+
+    /* Destroys every recorded command without applying it, entities
+     * created through the buffer are released again */
+    void clear();
+
+    [[nodiscard]] MemoryUsage get_memory_usage() const;
+
+    /* Releases every page but the first */
+    void compact();
+};
+
+/*
+ * Prefab captures a set of components along with the value each of
+ * them starts out with, such that Registry::instantiate can create
+ * any number of entities from it in one batch. Components of a
+ * prefab must be copy constructible */
+class Prefab {
+   private:
+    struct Prototype {
+        const ComponentInfo *info;
+        std::unique_ptr<void, void (*)(void *)> value;
+
+        /* Returns the pool of the component in the registry */
+        IPool &(*get_pool)(class Registry &registry);
+    };
+
+    ComponentSignature _signature;
+
+    /* Every component of the prefab except tags */
+    std::vector<Prototype> _prototypes;
+
+    friend class Registry;
+
+   public:
+    Prefab() : _signature(), _prototypes() {}
+    ~Prefab() = default;
+
+    Prefab(const Prefab &) = delete;
+    Prefab &operator=(const Prefab &) = delete;
+    Prefab(Prefab &&) = default;
+    Prefab &operator=(Prefab &&) = default;
+
+    [[nodiscard]] inline const ComponentSignature &get_signature() const {
+        return _signature;
+    }
+
+    template <typename TComponent>
+    [[nodiscard]] inline bool has_component() const {
+        return _signature.test(Component<TComponent>::get_id());
+    }
+
+    /* Adds or replaces the prototype of TComponent, which is
+     * returned such that it can be set up further */
+    template <typename TComponent, typename... TComponentArgs>
+    TComponent &add_component(TComponentArgs &&...args);
+
+    template <typename TComponent>
+    TComponent &get_component() const;
+};
+
+/* Cache line size assumed when keeping data apart between threads */
+constexpr std::size_t CACHE_LINE_SIZE{64};
+
+/*
+ * IResource holds a singleton of the registry, such as frame timing or
+ * configuration, which systems read instead of global state */
+class IResource {
+   public:
+    virtual ~IResource() = default;
+
+    [[nodiscard]] virtual std::size_t get_size() const = 0;
+};
+
+/* Each resource has cache lines of its own, such that systems reading
+ * it never share them with components that other threads write */
+template <typename T>
+struct alignas(CACHE_LINE_SIZE) Resource final : IResource {
+    T value;
+
+    template <typename... TArgs>
+    explicit Resource(TArgs &&...args)
+        : value{std::forward<TArgs>(args)...} {}
+
+    [[nodiscard]] inline std::size_t get_size() const override {
+        return sizeof(Resource<T>);
+    }
+};
+
+/*
+ * Registry manages creation and destruction of entities,
+ * adding systems and adding components to entities
+ * */
+class Registry {
+   private:
+    IdCounter _entity_counter;
+
+    /* Current tick, components changed now are stamped with it */
+    TickCounter _tick;
+
+    const Storage _storage;
+
+    /* Pages of every pool and archetype chunk, declared before
+     * them such that it outlives the components it holds */
+    Arena _arena;
+
+    /* Holds every component when using archetype storage */
+    ArchetypeStorage _archetypes;
+
+    /* Each pool contains all data for a certain component type.
+     * Vector index is component id, pools are keyed by entity id */
+    std::vector<std::shared_ptr<IPool>> _component_pools;
+
+    /* Vector of component signatures per entity.
+     * Vector index is equal to entity index */
+    std::vector<ComponentSignature> _entity_component_signatures;
+
+    /* Current id (index and generation) handed out for each
+     * entity index. Vector index is equal to entity index */
+    std::vector<Id> _entity_ids;
+
+    /* Index is component id of the resource type, slots
+     * of resources not set are null */
+    std::vector<std::unique_ptr<IResource>> _resources;
+
+    /* Index is system id, slots of systems not added are null */
+    std::vector<std::unique_ptr<System>> _systems;
+
+    /* Every system in the order they were added, and per phase */
+    std::vector<System *> _system_order;
+    std::array<std::vector<System *>, PHASE_COUNT> _phases;
+
+    struct QueryKey {
+        ComponentSignature include;
+        ComponentSignature exclude;
+
+        inline bool operator==(const QueryKey &other) const {
+            return include == other.include && exclude == other.exclude;
+        }
+    };
+
+    struct QueryKeyHash {
+        inline std::size_t operator()(const QueryKey &key) const {
+            return key.include.hash() ^ (key.exclude.hash() << 1);
+        }
+    };
+
+    /* Entity sets of cached queries, maintained like those of systems.
+     * A cache only referenced from here has no handles left */
+    std::unordered_map<QueryKey, std::shared_ptr<System>, QueryKeyHash>
+        _queries;
+
+    /* Save entities whose signature changed (including newly
+     * created ones) and entities to remove, such that they can
+     * be processed in bulk at the end of each frame */
+    std::vector<Entity> _entities_changed_queue;
+    std::vector<Entity> _entities_remove_queue;
+
+    /* Number of entities that have the Disabled tag */
+    std::size_t _disabled_count;
+
+    /* Whether the entity is in the changed queue.
+     * Vector index is equal to entity index */
+    std::vector<bool> _entity_changed;
+
+    /* Saves the index of a destroyed entity such that it can be
+     * reused for other new entities. Indices are recycled in FIFO
+     * order, which keeps generations from wrapping around quickly */
+    std::deque<Id> _free_ids;
+
+    /* Entities reserved by command buffers that were cleared without
+     * being played back, recycled by the next update */
+    std::vector<Id> _released_ids;
+
+    /* Guards reserving entities from command buffers */
+    std::mutex _reserve_mutex;
+
+    /* Identifies the registry in the thread-local buffer cache */
+    const std::size_t _serial;
+
+    std::unordered_map<std::thread::id, std::unique_ptr<CommandBuffer>>
+        _command_buffers;
+
+    /* Buffers in the order they were created, commands with the same
+     * key and sequence are played back in this order */
+    std::vector<CommandBuffer *> _command_buffer_order;
+    std::mutex _command_buffers_mutex;
+
+    /* Owning groups, each pool is owned by at most one of them */
+    std::unordered_map<std::type_index, std::unique_ptr<IGroup>> _groups;
+
+    /* Commands of every buffer, sorted when played back */
+    std::vector<CommandBuffer::Command *> _commands;
+
+    /* Callbacks observing one component, along with the entities
+     * waiting for the next update to be dispatched to them */
+    struct ComponentObservers {
+        std::array<std::vector<std::pair<Id, ObserverCallback>>,
+                   COMPONENT_EVENT_COUNT>
+            callbacks;
+        std::vector<Entity> constructed;
+        std::vector<Entity> destroyed;
+
+        /* Changes after this tick are dispatched as updates */
+        Tick last_dispatch;
+    };
+
+    /* Index is component id, grown as components are observed */
+    std::vector<ComponentObservers> _observers;
+
+    /* Per event, the components having at least one callback */
+    std::array<ComponentSignature, COMPONENT_EVENT_COUNT> _observed;
+    Id _next_observer_id;
+    bool _is_dispatching;
+
+    /* Batches handed to callbacks, reused between updates */
+    std::vector<Entity> _observer_batch;
+    std::vector<Id> _changed_ids;
+
+    Id _connect_observer(ComponentEvent event, Id component_id,
+                         ObserverCallback callback);
+
+    /* Queues the event if the component is observed, it is
+     * dispatched at the end of the next update */
+    inline void _observe(ComponentEvent event, Id component_id,
+                         Entity entity) {
+        if (!_observed[static_cast<std::size_t>(event)].test(component_id)) {
+            return;
+        }
+        Entity observed{entity.get_id()};
+        observed.registry = this;
+        ComponentObservers &observers{_observers[component_id]};
+        if (event == ComponentEvent::construct) {
+            observers.constructed.push_back(observed);
+        } else {
+            observers.destroyed.push_back(observed);
+        }
+    }
+
+    /* Calls every observer with the events since the last update */
+    void _dispatch_observers();
+
+    /* Queues the event for every observed component of the entity,
+     * such as when it is about to be destroyed */
+    void _observe_components(ComponentEvent event, Entity entity);
+
+    template <typename TComponent>
+    inline void _observe_added(const ComponentSignature &existing,
+                               Entity entity) {
+        const Id component_id{Component<TComponent>::get_id()};
+        if (!existing.test(component_id)) {
+            _observe(ComponentEvent::construct, component_id, entity);
+        }
+    }
+
+    /* Takes an unused entity id without making it alive */
+    Entity _reserve_entity();
+
+    /* Makes a reserved entity alive */
+    void _materialize_entity(Entity entity);
+
+    /* Hands a reserved entity that never came alive back, safe to call
+     * from any thread. It is recycled by _recycle_released_entities */
+    void _release_reserved_entity(Entity entity);
+
+    void _recycle_released_entities();
+
+    /* Applies and clears every command buffer */
+    void _play_commands();
+
+    friend class CommandBuffer;
+    friend class Prefab;
+
+    /* Whether an entity with the signature belongs to the system */
+    [[nodiscard]] static bool _is_interested(
+        const System &system, const ComponentSignature &signature);
+
+    /* Adds or removes the entity from the system as its signature
+     * now requires, tracing the change under name */
+    static void _update_membership(System &system, Entity entity,
+                                   const ComponentSignature &signature,
+                                   const char *name);
+
+    /* Add entity to systems whose signature it now matches
+     * and remove it from systems it no longer matches */
+    void _update_entity_systems(Entity entity);
+
+    /* Drops every cached query without any handle left */
+    void _release_queries();
+
+    /* Remove entity from systems it is a member of */
+    void _remove_entity_from_systems(Entity entity);
+
+    inline void _queue_signature_change(Entity entity) {
+        const Id index{entity.get_index()};
+        if (!_entity_changed[index]) {
+            _entity_changed[index] = true;
+            _entities_changed_queue.push_back(entity);
+        }
+    }
+
+    /* Remove every component the entity has from their pools */
+    void _remove_entity_components(Entity entity);
+
+    /* Components entities yielded by views must not have */
+    [[nodiscard]] inline ComponentSignature _get_view_exclusions() const {
+        ComponentSignature without{};
+        if (_disabled_count > 0) {
+            without.set(Component<Disabled>::get_id());
+        }
+        return without;
+    }
+
+    /* Sets or clears a tag, which only touches the signature */
+    template <typename TComponent>
+    inline void _set_tag(Entity entity, bool value) {
+        const Id component_id{Component<TComponent>::get_id()};
+        ComponentSignature &signature{
+            _entity_component_signatures[entity.get_index()]};
+        if (signature.test(component_id) == value) {
+            return;
+        }
+        signature.set(component_id, value);
+        _observe(value ? ComponentEvent::construct : ComponentEvent::destroy,
+                 component_id, entity);
+        if constexpr (std::is_same_v<TComponent, Disabled>) {
+            value ? _disabled_count++ : _disabled_count--;
+        }
+        _queue_signature_change(entity);
+    }
+
+    /* Lets the group owning the pool, if any, pack the entity */
+    inline static void _notify_added(IPool &pool, Id entity_id) {
+        if (IGroup *group{pool.get_group()}) {
+            group->on_added(entity_id);
+        }
+    }
+
+    /* Must be called before the component is removed from the pool */
+    inline static void _notify_removed(IPool &pool, Id entity_id) {
+        if (IGroup *group{pool.get_group()}) {
+            group->on_removed(entity_id);
+        }
+    }
+
+    template <typename TComponent>
+    inline Pool<TComponent> &_get_or_create_pool() {
+        const Id component_id{Component<TComponent>::get_id()};
+        if (component_id >=
+            static_cast<unsigned int>(_component_pools.size())) {
+            /* Resize by one, since the resizing should be rare
+             * so using the default vector resize could be expensive */
+            _component_pools.resize(component_id + 1, nullptr);
+        }
+        if (!_component_pools[component_id]) {
+            _component_pools[component_id] =
+                std::make_shared<Pool<TComponent>>(_arena, &_tick);
+        }
+        return *static_cast<Pool<TComponent> *>(
+            _component_pools[component_id].get());
+    }
+
+   public:
+    explicit Registry(Storage storage = Storage::pools);
+    ~Registry() = default;
+
+    Registry(const Registry &) = delete;
+    Registry &operator=(const Registry &) = delete;
+
+    [[nodiscard]] inline Storage get_storage() const { return _storage; }
+
+    /* Plays back command buffers and processes queued changes, must
+     * not be called while any system is running */
+    void update();
+
+    /* Structural changes made directly on the registry are not
+     * thread-safe, use a command buffer while systems run */
+    Entity create_entity();
+    void destroy_entity(Entity entity);
+
+    /* Returns the command buffer of the calling thread */
+    CommandBuffer &get_command_buffer();
+
+    [[nodiscard]] inline Tick get_tick() const {
+        return _tick.load(std::memory_order_relaxed);
+    }
+
+    /* Moves on to the next tick and returns the previous one, such
+     * that every change made from now on is newer than it */
+    inline Tick advance_tick() {
+        return _tick.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /* Creates count entities at once, which are queued
+     * to be added to systems in one batch */
+    std::vector<Entity> create_entities(std::size_t count);
+
+    /* Creates count entities with a copy of every component of the
+     * prefab. Each component is copied to all of the entities in one
+     * pass, and the entities are added to systems in one batch */
+    std::vector<Entity> instantiate(const Prefab &prefab,
+                                    std::size_t count = 1);
+
+    /* Bytes held by entity tables, systems and component storage */
+    [[nodiscard]] MemoryUsage get_memory_usage() const;
+
+    /* Releases memory that is no longer needed, e.g. after a large
+     * despawn on level transitions. Returns the number of bytes freed */
+    std::size_t compact();
+
+    /* Writes every entity and component to writer, each pool as one
+     * block. Components are written as raw bytes when trivially
+     * copyable, otherwise through their serializer (see snapshot.hpp).
+     * Requires pool storage, and fails if any component can not be
+     * written. Components must have the same id when restoring, which
+     * only holds for unregistered components if they are first used
+     * in the same order. Must not be called while systems run */
+    [[nodiscard]] bool snapshot(SnapshotWriter &writer) const;
+
+    /* Replaces every entity with those of a snapshot, keeping systems,
+     * groups, queries and observers. Destroy and construct observers
+     * are called as if the entities were destroyed and recreated, and
+     * every restored component counts as added. The pool of every
+     * component in the snapshot must exist, see register_components.
+     * Components holding entities must be written through a serializer
+     * that stores their ids and rebinds them to SnapshotReader::registry
+     * on restore, see ParentComponent. Snapshots whose tables, free list
+     * or pools disagree are rejected, after which the registry is empty */
+    [[nodiscard]] bool restore(SnapshotReader &reader);
+
+    /* Creates the pools of TComponents up front, such that a fresh
+     * registry can restore snapshots holding them */
+    template <typename... TComponents>
+    inline void register_components() {
+        if (_storage == Storage::pools) {
+            (_get_or_create_pool<TComponents>(), ...);
+        }
+    }
+
+    /* Destroys every entity at once, e.g. when unloading a level.
+     * Components are released page by page rather than one entity at
+     * a time, while systems, groups and observers are kept. Destroy
+     * observers are still called, and handles to the destroyed
+     * entities become stale. Must not be called while systems run */
+    void clear();
+
+    /* An entity is alive from creation until the update that processes
+     * its destruction, after which every copy of its handle is stale */
+    [[nodiscard]] inline bool is_alive(Entity entity) const {
+        const Id index{entity.get_index()};
+        return index < _entity_ids.size() &&
+               _entity_ids[index] == entity.get_id();
+    }
+
+    template <typename TComponent, typename... TComponentArgs>
+    inline TComponent &add_component(Entity entity, TComponentArgs &&...args) {
+        assert(is_alive(entity));
+
+        spdlog::trace("adding {0} to entity {1:d}", typeid(TComponent).name(),
+                      entity.get_index());
+
+        if constexpr (is_tag_v<TComponent>) {
+            _set_tag<TComponent>(entity, true);
+            return get_component<TComponent>(entity);
+        } else {
+            const Id component_id{Component<TComponent>::get_id()};
+            ComponentSignature &signature{
+                _entity_component_signatures[entity.get_index()]};
+            /* replacing a component is reported as an update instead */
+            if (!signature.test(component_id)) {
+                signature.set(component_id);
+                _observe(ComponentEvent::construct, component_id, entity);
+            }
+            _queue_signature_change(entity);
+            if (_storage == Storage::archetypes) {
+                return _archetypes.emplace<TComponent>(
+                    entity.get_id(), std::forward<TComponentArgs>(args)...);
+            }
+            Pool<TComponent> &pool{_get_or_create_pool<TComponent>()};
+            if (!pool.get_group()) {
+                return pool.emplace(entity.get_id(),
+                                    std::forward<TComponentArgs>(args)...);
+            }
+            /* the group may move the component when packing the entity */
+            pool.emplace(entity.get_id(),
+                         std::forward<TComponentArgs>(args)...);
+            _notify_added(pool, entity.get_id());
+            return pool.get_item(entity.get_id());
+        }
+    }
+
+    /* Adds TComponents to every entity of entities, where generator(i,
+     * entity) returns a std::tuple holding the components of the i-th
+     * entity. Storage for the whole batch is reserved up front */
+    template <typename... TComponents, typename TEntities,
+              typename TGenerator>
+    inline void emplace_components(const TEntities &entities,
+                                   TGenerator &&generator) {
+        static_assert(!(is_tag_v<TComponents> || ...),
+                      "tags must be added with add_component");
+        ComponentSignature signature{};
+        (signature.set(Component<TComponents>::get_id()), ...);
+        const auto count{static_cast<unsigned int>(std::size(entities))};
+
+        spdlog::trace("adding {0} to {1:d} entities",
+                      typeid(std::tuple<TComponents...>).name(), count);
+
+        std::tuple<Pool<TComponents> *...> pools{};
+        if (_storage == Storage::pools) {
+            pools = {&_get_or_create_pool<TComponents>()...};
+            (std::get<Pool<TComponents> *>(pools)->reserve(count), ...);
+        }
+        std::size_t i{0};
+        for (const Entity entity : entities) {
+            assert(is_alive(entity));
+            std::tuple<TComponents...> components{generator(i++, entity)};
+            if (_storage == Storage::archetypes) {
+                _archetypes.insert(
+                    entity.get_id(),
+                    std::move(std::get<TComponents>(components))...);
+            } else {
+                (std::get<Pool<TComponents> *>(pools)->emplace(
+                     entity.get_id(),
+                     std::move(std::get<TComponents>(components))),
+                 ...);
+                (_notify_added(*std::get<Pool<TComponents> *>(pools),
+                               entity.get_id()),
+                 ...);
+            }
+            ComponentSignature &existing{
+                _entity_component_signatures[entity.get_index()]};
+            if (signature.intersects(_observed[static_cast<std::size_t>(
+                    ComponentEvent::construct)])) {
+                (_observe_added<TComponents>(existing, entity), ...);
+            }
+            existing |= signature;
+            _queue_signature_change(entity);
+        }
+    }
+
+    template <typename TComponent>
+    inline void remove_component(Entity entity) {
+        assert(is_alive(entity));
+
+        spdlog::trace("removing {0} from entity {1:d}",
+                      typeid(TComponent).name(), entity.get_index());
+
+        if constexpr (is_tag_v<TComponent>) {
+            _set_tag<TComponent>(entity, false);
+        } else {
+            const Id component_id{Component<TComponent>::get_id()};
+            if (has_component<TComponent>(entity)) {
+                _observe(ComponentEvent::destroy, component_id, entity);
+            }
+            if (_storage == Storage::archetypes) {
+                _archetypes.remove<TComponent>(entity.get_id());
+            } else if (Pool<TComponent> *pool{get_pool<TComponent>()}) {
+                _notify_removed(*pool, entity.get_id());
+                pool->remove(entity.get_id());
+            }
+            _entity_component_signatures[entity.get_index()].set(component_id,
+                                                                  false);
+            _queue_signature_change(entity);
+        }
+    }
+
+    template <typename TComponent>
+    inline bool has_component(Entity entity) const {
+        assert(is_alive(entity));
+        const Id component_id{Component<TComponent>::get_id()};
+        return _entity_component_signatures[entity.get_index()].test(
+            component_id);
+    }
+
+    /* Stamps the component as changed, such that views filtered
+     * with changed<TComponent> pick it up. Safe to call concurrently
+     * for distinct entities, a no-op with archetype storage */
+    template <typename TComponent>
+    inline void mark_changed(Entity entity) {
+        assert(is_alive(entity));
+        if (Pool<TComponent> *pool{get_pool<TComponent>()}) {
+            pool->mark_changed(entity.get_id());
+        }
+    }
+
+    /* Same as get_component, but marks the component as changed */
+    template <typename TComponent>
+    inline TComponent &get_mut(Entity entity) {
+        mark_changed<TComponent>(entity);
+        return get_component<TComponent>(entity);
+    }
+
+    /* Calls fn(component) and marks the component as changed */
+    template <typename TComponent, typename TFunc>
+    inline void patch(Entity entity, TFunc &&fn) {
+        fn(get_component<TComponent>(entity));
+        mark_changed<TComponent>(entity);
+    }
+
+    template <typename TComponent>
+    inline TComponent &get_component(Entity entity) const {
+        assert(is_alive(entity));
+        if constexpr (is_tag_v<TComponent>) {
+            /* every tag of a type is the same empty object */
+            static TComponent tag{};
+            return tag;
+        } else if (_storage == Storage::archetypes) {
+            return _archetypes.get<TComponent>(entity.get_id());
+        } else {
+            return get_pool<TComponent>()->get_item(entity.get_id());
+        }
+    }
+
+    /* Returns the pool holding every TComponent, or nullptr if no
+     * entity has ever had one or when using archetype storage */
+    template <typename TComponent>
+    inline Pool<TComponent> *get_pool() const {
+        const Id component_id{Component<TComponent>::get_id()};
+        if (component_id >= _component_pools.size()) {
+            return nullptr;
+        }
+        return static_cast<Pool<TComponent> *>(
+            _component_pools[component_id].get());
+    }
+
+    /* Disabling only flips a tag, so toggling is O(1) per entity */
+    inline void set_enabled(Entity entity, bool enabled) {
+        assert(is_alive(entity));
+        _set_tag<Disabled>(entity, !enabled);
+    }
+
+    [[nodiscard]] inline bool is_enabled(Entity entity) const {
+        return !has_component<Disabled>(entity);
+    }
+
+    [[nodiscard]] inline std::size_t get_disabled_count() const {
+        return _disabled_count;
+    }
+
+    /* Returns a view over every enabled entity that has all of
+     * TComponents, which may be further filtered by tags */
+    template <typename... TComponents>
+    inline View<TComponents...> view() {
+        if (_storage == Storage::archetypes) {
+            ComponentSignature signature{};
+            (signature.set(Component<TComponents>::get_id()), ...);
+            return View<TComponents...>(this, &_entity_component_signatures,
+                                        _get_view_exclusions(),
+                                        &_archetypes.query(signature));
+        }
+        return View<TComponents...>(this, &_entity_component_signatures,
+                                    _get_view_exclusions(),
+                                    get_pool<TComponents>()...);
+    }
+
+    /* Returns the group owning the pools of TComponents, creating it
+     * and packing every matching entity when called the first time.
+     * A pool is owned by at most one group, asking for a group over a
+     * pool another group owns aborts */
+    template <typename... TComponents>
+    Group<TComponents...> &group();
+
+    /* Adds the system to the end of its phase */
+    template <typename TSystem, typename... TSystemArgs>
+    inline void add_system(TSystemArgs &&...args) {
+        const Id system_id{SystemType<TSystem>::get_id()};
+        if (system_id >= _systems.size()) {
+            _systems.resize(system_id + 1);
+        }
+        if (_systems[system_id]) {
+            spdlog::warn("tried to add existing {0} to registry",
+                         typeid(TSystem).name());
+            return;
+        }
+        auto system{
+            std::make_unique<TSystem>(std::forward<TSystemArgs>(args)...)};
+        system->registry = this;
+        _system_order.push_back(system.get());
+        _phases[static_cast<std::size_t>(system->get_phase())].push_back(
+            system.get());
+        _systems[system_id] = std::move(system);
+    }
+
+    template <typename TSystem>
+    inline void remove_system() {
+        if (!has_system<TSystem>()) {
+            spdlog::warn("tried to remove non-existent {0} from registry",
+                         typeid(TSystem).name());
+            return;
+        }
+        spdlog::debug("removing {0} from registry", typeid(TSystem).name());
+        auto &system{_systems[SystemType<TSystem>::get_id()]};
+        auto &phase{_phases[static_cast<std::size_t>(system->get_phase())]};
+        phase.erase(std::find(phase.begin(), phase.end(), system.get()));
+        _system_order.erase(std::find(_system_order.begin(),
+                                      _system_order.end(), system.get()));
+        system.reset();
+    }
+
+    template <typename TSystem>
+    [[nodiscard]] inline bool has_system() const {
+        const Id system_id{SystemType<TSystem>::get_id()};
+        return system_id < _systems.size() && _systems[system_id];
+    }
+
+    template <typename TSystem>
+    inline TSystem &get_system() const {
+        assert(has_system<TSystem>());
+        return static_cast<TSystem &>(
+            *_systems[SystemType<TSystem>::get_id()]);
+    }
+
+    /* Systems of the phase in the order they run */
+    [[nodiscard]] inline const std::vector<System *> &get_systems(
+        Phase phase) const {
+        return _phases[static_cast<std::size_t>(phase)];
+    }
+
+    /*
+     * Resources are singletons of the registry, one per type. They share
+     * ids with components, such that systems declare access to them with
+     * System::access_resource and the scheduler keeps readers and
+     * writers apart. Setting and removing resources is not thread-safe,
+     * and they are kept by clear() and restore() */
+    template <typename TResource, typename... TResourceArgs>
+    inline TResource &set_resource(TResourceArgs &&...args) {
+        const Id resource_id{Component<TResource>::get_id()};
+        if (resource_id >= _resources.size()) {
+            _resources.resize(resource_id + 1);
+        }
+        spdlog::debug("setting resource {0}", typeid(TResource).name());
+        auto resource{std::make_unique<Resource<TResource>>(
+            std::forward<TResourceArgs>(args)...)};
+        TResource &value{resource->value};
+        _resources[resource_id] = std::move(resource);
+        return value;
+    }
+
+    template <typename TResource>
+    [[nodiscard]] inline bool has_resource() const {
+        const Id resource_id{Component<TResource>::get_id()};
+        return resource_id < _resources.size() && _resources[resource_id];
+    }
+
+    template <typename TResource>
+    [[nodiscard]] inline TResource &resource() const {
+        assert(has_resource<TResource>());
+        return static_cast<Resource<TResource> &>(
+                   *_resources[Component<TResource>::get_id()])
+            .value;
+    }
+
+    /* Returns whether the resource was set */
+    template <typename TResource>
+    inline bool remove_resource() {
+        if (!has_resource<TResource>()) {
+            return false;
+        }
+        spdlog::debug("removing resource {0}", typeid(TResource).name());
+        _resources[Component<TResource>::get_id()].reset();
+        return true;
+    }
+
+    /* Updates every enabled system of the phase in order */
+    void run_systems(Phase phase, float delta_time);
+
+    /* Returns a handle to the cached set of entities that have every
+     * included and none of the excluded components, creating the set
+     * when no handle to it exists. Creating it visits every entity,
+     * so keep the handle around rather than asking again each frame.
+     * Handles must not outlive the registry */
+    Query query(const ComponentSignature &include,
+                const ComponentSignature &exclude = {});
+
+    /* Same as above with the included components as types */
+    template <typename... TComponents>
+    inline Query query() {
+        return query(make_signature<TComponents...>());
+    }
+
+    /*
+     * Observers are called at the end of update() with every entity
+     * the event happened to since the previous update, rather than
+     * once per event, such that bulk spawns are handled in one go.
+     * By then the entity may have lost the component again or been
+     * destroyed, so check has_component or is_alive if that matters.
+     * Observers must not be connected or disconnected from a callback.
+     * Each returns an id to pass to disconnect_observer */
+
+    /* Called with entities that got TComponent */
+    template <typename TComponent>
+    inline Id on_construct(ObserverCallback callback) {
+        return _connect_observer(ComponentEvent::construct,
+                                 Component<TComponent>::get_id(),
+                                 std::move(callback));
+    }
+
+    /* Called with entities whose TComponent was marked changed or
+     * replaced. Changes are found through the change ticks of the
+     * pool, so writing components stays free of any bookkeeping,
+     * but it requires pool storage */
+    template <typename TComponent>
+    inline Id on_update(ObserverCallback callback) {
+        static_assert(!is_tag_v<TComponent>, "tags can not change");
+        return _connect_observer(ComponentEvent::update,
+                                 Component<TComponent>::get_id(),
+                                 std::move(callback));
+    }
+
+    /* Called with entities that lost TComponent, including when they
+     * were destroyed. The component is gone by the time it is called */
+    template <typename TComponent>
+    inline Id on_destroy(ObserverCallback callback) {
+        return _connect_observer(ComponentEvent::destroy,
+                                 Component<TComponent>::get_id(),
+                                 std::move(callback));
+    }
+
+    void disconnect_observer(Id observer_id);
+};
+
+template <typename... TComponents>
+Group<TComponents...> &Registry::group() {
+    static_assert(sizeof...(TComponents) > 1,
+                  "a group must own at least two components");
+    auto &slot{_groups[std::type_index(typeid(Group<TComponents...>))]};
+    if (slot) {
+        return *static_cast<Group<TComponents...> *>(slot.get());
+    }
+    if (_storage == Storage::archetypes) {
+        /* nothing to own, archetypes keep components packed already */
+        slot = std::make_unique<Group<TComponents...>>(
+            this, static_cast<Pool<TComponents> *>(nullptr)...);
+        return *static_cast<Group<TComponents...> *>(slot.get());
+    }
+    std::tuple<Pool<TComponents> *...> pools{
+        &_get_or_create_pool<TComponents>()...};
+    if (((std::get<Pool<TComponents> *>(pools)->get_group() != nullptr) ||
+         ...)) {
+        /* taking the pool over would corrupt the packed
+         * entities of the group that owns it */
+        spdlog::critical("{0} is already owned by another group",
+                         typeid(std::tuple<TComponents...>).name());
+        std::abort();
+    }
+    auto group{std::make_unique<Group<TComponents...>>(
+        this, std::get<Pool<TComponents> *>(pools)...)};
+    (std::get<Pool<TComponents> *>(pools)->set_group(group.get()), ...);
+    /* pack the entities that already have every component */
+    const auto *pool{std::get<0>(pools)};
+    std::vector<Id> entities(pool->get_entities(),
+                             pool->get_entities() + pool->get_size());
+    for (const Id entity_id : entities) {
+        group->on_added(entity_id);
+    }
+    spdlog::debug("created group {0} with {1:d} entities",
+                  typeid(std::tuple<TComponents...>).name(),
+                  group->get_size());
+    slot = std::move(group);
+    return *static_cast<Group<TComponents...> *>(slot.get());
+}
+
+template <typename... TComponents>
+unsigned int Group<TComponents...>::size_hint() const {
+    if (!_is_owning) {
+        return _registry->view<TComponents...>().size_hint();
+    }
+    return _size;
+}
+
+template <typename... TComponents>
+template <typename TFunc>
+void Group<TComponents...>::each(std::size_t first, std::size_t last,
+                                 TFunc &&fn) const {
+    if (!_is_owning) {
+        _registry->view<TComponents...>().each(first, last, fn);
+        return;
+    }
+    const Id *entities{get_entities()};
+    const bool has_disabled{_registry->get_disabled_count() > 0};
+    /* walked in runs that stay within one page of every pool, such
+     * that the components of each run are plain arrays */
+    for (Id run = static_cast<Id>(first); run < last;) {
+        const Id end{std::min(
+            {static_cast<Id>(last),
+             run + std::get<Pool<TComponents> *>(_pools)->get_page_remaining(
+                       run)...})};
+        std::tuple<TComponents *...> data{&at<TComponents>(run)...};
+        for (Id i = run; i < end; i++) {
+            Entity entity{entities[i]};
+            entity.registry = _registry;
+            if (has_disabled && !_registry->is_enabled(entity)) {
+                continue;
+            }
+            fn(entity, std::get<TComponents *>(data)[i - run]...);
+        }
+        run = end;
+    }
+}
+
+template <typename TComponent, typename... TComponentArgs>
+TComponent &Prefab::add_component(TComponentArgs &&...args) {
+    static_assert(std::is_copy_constructible_v<TComponent>,
+                  "prefab components are copied to every instance");
+    if constexpr (is_tag_v<TComponent>) {
+        _signature.set(Component<TComponent>::get_id());
+        return get_component<TComponent>();
+    } else {
+        if (has_component<TComponent>()) {
+            TComponent &prototype{get_component<TComponent>()};
+            prototype = TComponent(std::forward<TComponentArgs>(args)...);
+            return prototype;
+        }
+        _signature.set(Component<TComponent>::get_id());
+        auto *prototype{
+            new TComponent(std::forward<TComponentArgs>(args)...)};
+        _prototypes.push_back(
+            {&get_component_info<TComponent>(),
+             {prototype,
+              [](void *value) { delete static_cast<TComponent *>(value); }},
+             [](Registry &registry) -> IPool & {
+                 return registry._get_or_create_pool<TComponent>();
+             }});
+        return *prototype;
+    }
+}
+
+template <typename TComponent>
+TComponent &Prefab::get_component() const {
+    assert(has_component<TComponent>());
+    if constexpr (is_tag_v<TComponent>) {
+        /* every tag of a type is the same empty object */
+        static TComponent tag{};
+        return tag;
+    } else {
+        const Id component_id{Component<TComponent>::get_id()};
+        const auto prototype{std::find_if(
+            _prototypes.begin(), _prototypes.end(),
+            [component_id](const Prototype &candidate) {
+                return candidate.info->id == component_id;
+            })};
+        return *static_cast<TComponent *>(prototype->value.get());
+    }
+}
+
+template <typename TComponent, typename... TComponentArgs>
+void CommandBuffer::add_component(Entity entity, TComponentArgs &&...args) {
+    static_assert(alignof(TComponent) <= alignof(std::max_align_t),
+                  "command payloads are only aligned to max_align_t");
+    Command &command{_push(CommandType::add, entity, sizeof(TComponent),
+                           alignof(TComponent))};
+    new (command.payload) TComponent(std::forward<TComponentArgs>(args)...);
+    command.apply = [](Registry &registry, Entity target, void *payload) {
+        registry.add_component<TComponent>(
+            target, std::move(*static_cast<TComponent *>(payload)));
+    };
+    command.release = [](void *payload) {
+        static_cast<TComponent *>(payload)->~TComponent();
+    };
+}
+
+template <typename TComponent>
+void CommandBuffer::remove_component(Entity entity) {
+    Command &command{_push(CommandType::remove, entity)};
+    command.apply = [](Registry &registry, Entity target, void *) {
+        registry.remove_component<TComponent>(target);
+    };
+}
+
 template <typename TComponent, typename... TComponentArgs>
 TComponent &Entity::add_component(TComponentArgs &&...args) {
     assert(registry);
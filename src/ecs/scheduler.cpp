@@ -0,0 +1,63 @@
+#include "scheduler.hpp"
+
+#include <utility>
+
+debby::ecs::Scheduler::Scheduler()
+    : _tasks({}), _jobs({}), _remaining(), _counter(0) {}
+
+void debby::ecs::Scheduler::add(const System &system,
+                                std::function<void()> run) {
+    _tasks.push_back({&system, std::move(run), {}, 0});
+}
+
+void debby::ecs::Scheduler::_build_graph() {
+    for (auto &task : _tasks) {
+        task.dependents.clear();
+        task.dependency_count = 0;
+    }
+    for (std::size_t i = 0; i < _tasks.size(); i++) {
+        for (std::size_t j = i + 1; j < _tasks.size(); j++) {
+            if (_tasks[i].system->conflicts_with(*_tasks[j].system)) {
+                _tasks[i].dependents.push_back(j);
+                _tasks[j].dependency_count++;
+            }
+        }
+    }
+}
+
+void debby::ecs::Scheduler::_run_task(const jobs::Job &job) {
+    auto *scheduler{static_cast<Scheduler *>(job.data)};
+    const Task &task{scheduler->_tasks[job.begin]};
+    if (task.system->is_enabled()) {
+        task.run();
+    }
+    /* dependents are submitted before this job counts as
+     * done, so the run cannot finish while any are left */
+    for (const std::size_t dependent : task.dependents) {
+        if (scheduler->_remaining[dependent].fetch_sub(
+                1, std::memory_order_acq_rel) == 1) {
+            jobs::submit(scheduler->_jobs[dependent]);
+        }
+    }
+}
+
+void debby::ecs::Scheduler::run() {
+    /* systems may change their declared access between
+     * runs, so the graph is rebuilt every time */
+    _build_graph();
+    if (_remaining.size() != _tasks.size()) {
+        _remaining = std::vector<std::atomic<std::size_t>>(_tasks.size());
+        _jobs.resize(_tasks.size());
+    }
+    for (std::size_t i = 0; i < _tasks.size(); i++) {
+        _remaining[i].store(_tasks[i].dependency_count,
+                            std::memory_order_relaxed);
+        _jobs[i] = {_run_task, this, i, i + 1, &_counter};
+    }
+    for (std::size_t i = 0; i < _tasks.size(); i++) {
+        if (_tasks[i].dependency_count == 0) {
+            jobs::submit(_jobs[i]);
+        }
+    }
+    jobs::wait(_counter);
+}
@@ -0,0 +1,62 @@
+#ifndef DEBBY_ECS_SCHEDULER_HPP_
+#define DEBBY_ECS_SCHEDULER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "../jobs/jobs.hpp"
+#include "./ecs.hpp"
+
+namespace debby::ecs {
+
+/*
+ * Scheduler runs systems concurrently on the job system. Each run
+ * builds a dependency graph from the components the systems declared
+ * they read and write, such that two systems only run at the same
+ * time if they do not conflict. Conflicting systems always run in
+ * the order they were added, which keeps results deterministic */
+class Scheduler {
+   private:
+    struct Task {
+        const System *system;
+        std::function<void()> run;
+
+        /* Tasks that may only start once this one is done */
+        std::vector<std::size_t> dependents;
+        std::size_t dependency_count;
+    };
+
+    std::vector<Task> _tasks;
+
+    /* One job per task, submitted once its dependencies are done */
+    std::vector<jobs::Job> _jobs;
+
+    /* Dependencies each task is still waiting on during a run */
+    std::vector<std::atomic<std::size_t>> _remaining;
+
+    jobs::Counter _counter;
+
+    void _build_graph();
+
+    static void _run_task(const jobs::Job &job);
+
+   public:
+    Scheduler();
+    ~Scheduler() = default;
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    /* Adds a task that runs the system, where the system declares
+     * which components the task accesses. The task is skipped
+     * while the system is disabled */
+    void add(const System &system, std::function<void()> run);
+
+    /* Runs every task once and blocks until all of them are done */
+    void run();
+};
+}  // namespace debby::ecs
+
+#endif  // DEBBY_ECS_SCHEDULER_HPP_
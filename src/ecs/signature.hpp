@@ -0,0 +1,187 @@
+#ifndef DEBBY_ECS_SIGNATURE_HPP_
+#define DEBBY_ECS_SIGNATURE_HPP_
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEBBY_ECS_SSE2
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/* Max number of components an entity can have, must be a multiple of 64.
+ * Each entity stores a signature, so only widen it when needed */
+#ifndef DEBBY_ECS_MAX_COMPONENTS
+#define DEBBY_ECS_MAX_COMPONENTS 64
+#endif
+
+namespace debby::ecs {
+/* Max number of components an entity can have */
+constexpr unsigned int MAX_COMPONENTS{DEBBY_ECS_MAX_COMPONENTS};
+
+static_assert(MAX_COMPONENTS > 0 && MAX_COMPONENTS % 64 == 0,
+              "DEBBY_ECS_MAX_COMPONENTS must be a multiple of 64");
+
+/*
+ * ComponentSignature describes which component(s) are enabled on an
+ * entity. Bits are stored in 64-bit words, such that signatures are
+ * compared a word at a time, or two at a time with SSE2 */
+class ComponentSignature {
+   private:
+    using Word = std::uint64_t;
+
+    static constexpr std::size_t WORD_BITS{64};
+    static constexpr std::size_t WORD_COUNT{MAX_COMPONENTS / WORD_BITS};
+
+    /* Pairs of words are loaded as one SSE2 register */
+    alignas(WORD_COUNT % 2 == 0 ? 16 : alignof(Word)) Word _words[WORD_COUNT];
+
+    [[nodiscard]] static constexpr Word _mask(std::size_t index) {
+        return Word{1} << (index % WORD_BITS);
+    }
+
+   public:
+    constexpr ComponentSignature() : _words{} {}
+
+    inline ComponentSignature &set(std::size_t index, bool value = true) {
+        if (value) {
+            _words[index / WORD_BITS] |= _mask(index);
+        } else {
+            reset(index);
+        }
+        return *this;
+    }
+
+    inline ComponentSignature &reset(std::size_t index) {
+        _words[index / WORD_BITS] &= ~_mask(index);
+        return *this;
+    }
+
+    inline ComponentSignature &reset() {
+        for (Word &word : _words) {
+            word = 0;
+        }
+        return *this;
+    }
+
+    [[nodiscard]] inline bool test(std::size_t index) const {
+        return (_words[index / WORD_BITS] & _mask(index)) != 0;
+    }
+
+    [[nodiscard]] inline bool any() const {
+        Word bits{0};
+        for (const Word word : _words) {
+            bits |= word;
+        }
+        return bits != 0;
+    }
+
+    [[nodiscard]] inline bool none() const { return !any(); }
+
+    /* True if every bit set in other is also set in this signature */
+    [[nodiscard]] inline bool contains(const ComponentSignature &other) const {
+#ifdef DEBBY_ECS_SSE2
+        if constexpr (WORD_COUNT % 2 == 0) {
+            __m128i missing{_mm_setzero_si128()};
+            for (std::size_t i = 0; i < WORD_COUNT; i += 2) {
+                const __m128i have{_mm_load_si128(
+                    reinterpret_cast<const __m128i *>(_words + i))};
+                const __m128i want{_mm_load_si128(
+                    reinterpret_cast<const __m128i *>(other._words + i))};
+                missing = _mm_or_si128(missing, _mm_andnot_si128(have, want));
+            }
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(
+                       missing, _mm_setzero_si128())) == 0xFFFF;
+        }
+#endif
+        Word missing{0};
+        for (std::size_t i = 0; i < WORD_COUNT; i++) {
+            missing |= other._words[i] & ~_words[i];
+        }
+        return missing == 0;
+    }
+
+    /* True if any bit is set in both signatures */
+    [[nodiscard]] inline bool intersects(
+        const ComponentSignature &other) const {
+        Word shared{0};
+        for (std::size_t i = 0; i < WORD_COUNT; i++) {
+            shared |= other._words[i] & _words[i];
+        }
+        return shared != 0;
+    }
+
+    inline ComponentSignature &operator|=(const ComponentSignature &other) {
+        for (std::size_t i = 0; i < WORD_COUNT; i++) {
+            _words[i] |= other._words[i];
+        }
+        return *this;
+    }
+
+    inline ComponentSignature &operator&=(const ComponentSignature &other) {
+        for (std::size_t i = 0; i < WORD_COUNT; i++) {
+            _words[i] &= other._words[i];
+        }
+        return *this;
+    }
+
+    [[nodiscard]] inline ComponentSignature operator|(
+        const ComponentSignature &other) const {
+        ComponentSignature result{*this};
+        return result |= other;
+    }
+
+    [[nodiscard]] inline ComponentSignature operator&(
+        const ComponentSignature &other) const {
+        ComponentSignature result{*this};
+        return result &= other;
+    }
+
+    [[nodiscard]] inline bool operator==(
+        const ComponentSignature &other) const {
+        Word difference{0};
+        for (std::size_t i = 0; i < WORD_COUNT; i++) {
+            difference |= other._words[i] ^ _words[i];
+        }
+        return difference == 0;
+    }
+
+    [[nodiscard]] inline bool operator!=(
+        const ComponentSignature &other) const {
+        return !(*this == other);
+    }
+
+    /* Highest component first, the same as std::bitset */
+    [[nodiscard]] inline std::string to_string() const {
+        std::string bits(MAX_COMPONENTS, '0');
+        for (std::size_t i = 0; i < MAX_COMPONENTS; i++) {
+            if (test(i)) {
+                bits[MAX_COMPONENTS - 1 - i] = '1';
+            }
+        }
+        return bits;
+    }
+
+    [[nodiscard]] inline std::size_t hash() const {
+        std::size_t seed{WORD_COUNT};
+        for (const Word word : _words) {
+            seed ^= static_cast<std::size_t>(word) + 0x9e3779b9 +
+                    (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+}  // namespace debby::ecs
+
+template <>
+struct std::hash<debby::ecs::ComponentSignature> {
+    inline std::size_t operator()(
+        const debby::ecs::ComponentSignature &signature) const {
+        return signature.hash();
+    }
+};
+
+#endif  // DEBBY_ECS_SIGNATURE_HPP_
@@ -0,0 +1,50 @@
+#include "snapshot.hpp"
+
+#include <cstring>
+#include <limits>
+
+bool debby::ecs::MemoryWriter::write(const void *data, std::size_t size) {
+    const auto *bytes{static_cast<const std::byte *>(data)};
+    _bytes.insert(_bytes.end(), bytes, bytes + size);
+    return true;
+}
+
+bool debby::ecs::MemoryReader::read(void *data, std::size_t size) {
+    if (size > _size - _offset) {
+        return false;
+    }
+    std::memcpy(data, _data + _offset, size);
+    _offset += size;
+    return true;
+}
+
+bool debby::ecs::StreamWriter::write(const void *data, std::size_t size) {
+    _stream->write(static_cast<const char *>(data),
+                   static_cast<std::streamsize>(size));
+    return _stream->good();
+}
+
+bool debby::ecs::StreamReader::read(void *data, std::size_t size) {
+    _stream->read(static_cast<char *>(data),
+                  static_cast<std::streamsize>(size));
+    return _stream->good() &&
+           _stream->gcount() == static_cast<std::streamsize>(size);
+}
+
+bool debby::ecs::write_string(SnapshotWriter &writer,
+                              const std::string &value) {
+    if (value.size() > std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+    const auto length{static_cast<std::uint32_t>(value.size())};
+    return write_value(writer, length) && writer.write(value.data(), length);
+}
+
+bool debby::ecs::read_string(SnapshotReader &reader, std::string &value) {
+    std::uint32_t length{0};
+    if (!read_value(reader, length)) {
+        return false;
+    }
+    value.resize(length);
+    return reader.read(value.data(), length);
+}
@@ -0,0 +1,150 @@
+#ifndef DEBBY_ECS_SNAPSHOT_HPP_
+#define DEBBY_ECS_SNAPSHOT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./types.hpp"
+
+namespace debby::ecs {
+
+/* Identifies snapshot data, "DBSN" in little endian */
+constexpr std::uint32_t SNAPSHOT_MAGIC{0x4E534244};
+
+/* Bumped whenever the layout of a snapshot changes */
+constexpr std::uint32_t SNAPSHOT_VERSION{1};
+
+/*
+ * SnapshotWriter receives the bytes of a registry snapshot. Writes
+ * return false once the destination fails, which aborts the snapshot */
+class SnapshotWriter {
+   public:
+    virtual ~SnapshotWriter() = default;
+
+    [[nodiscard]] virtual bool write(const void *data, std::size_t size) = 0;
+};
+
+/*
+ * SnapshotReader hands back the bytes of a registry snapshot. Reads
+ * return false when fewer than size bytes are left */
+class SnapshotReader {
+   public:
+    /* Registry being restored, set by Registry::restore such
+     * that serializers can rebind the entities they read */
+    class Registry *registry = nullptr;
+
+    virtual ~SnapshotReader() = default;
+
+    [[nodiscard]] virtual bool read(void *data, std::size_t size) = 0;
+};
+
+/* Keeps a snapshot in memory, e.g. for level reloads and test fixtures */
+class MemoryWriter final : public SnapshotWriter {
+   private:
+    std::vector<std::byte> _bytes;
+
+   public:
+    MemoryWriter() : _bytes({}) {}
+
+    [[nodiscard]] bool write(const void *data, std::size_t size) override;
+
+    [[nodiscard]] inline const std::vector<std::byte> &get_bytes() const {
+        return _bytes;
+    }
+};
+
+class MemoryReader final : public SnapshotReader {
+   private:
+    const std::byte *_data;
+    std::size_t _size;
+    std::size_t _offset;
+
+   public:
+    MemoryReader(const std::byte *data, std::size_t size)
+        : _data(data), _size(size), _offset(0) {}
+
+    explicit MemoryReader(const std::vector<std::byte> &bytes)
+        : MemoryReader(bytes.data(), bytes.size()) {}
+
+    [[nodiscard]] bool read(void *data, std::size_t size) override;
+};
+
+/* Writes to a stream, such as a save game opened in binary mode */
+class StreamWriter final : public SnapshotWriter {
+   private:
+    std::ostream *_stream;
+
+   public:
+    explicit StreamWriter(std::ostream &stream) : _stream(&stream) {}
+
+    [[nodiscard]] bool write(const void *data, std::size_t size) override;
+};
+
+class StreamReader final : public SnapshotReader {
+   private:
+    std::istream *_stream;
+
+   public:
+    explicit StreamReader(std::istream &stream) : _stream(&stream) {}
+
+    [[nodiscard]] bool read(void *data, std::size_t size) override;
+};
+
+template <typename TValue>
+[[nodiscard]] inline bool write_value(SnapshotWriter &writer,
+                                      const TValue &value) {
+    static_assert(std::is_trivially_copyable_v<TValue>,
+                  "only trivially copyable values are written as bytes");
+    return writer.write(&value, sizeof(TValue));
+}
+
+template <typename TValue>
+[[nodiscard]] inline bool read_value(SnapshotReader &reader, TValue &value) {
+    static_assert(std::is_trivially_copyable_v<TValue>,
+                  "only trivially copyable values are read as bytes");
+    return reader.read(&value, sizeof(TValue));
+}
+
+/* Strings are written as their length followed by their characters */
+[[nodiscard]] bool write_string(SnapshotWriter &writer,
+                                const std::string &value);
+
+[[nodiscard]] bool read_string(SnapshotReader &reader, std::string &value);
+
+/*
+ * Components that are not trivially copyable, or that must not be
+ * copied as raw bytes, are serialized by a pair of functions found
+ * through ADL, typically hidden friends of the component:
+ *
+ *   bool debby_ecs_write(ecs::SnapshotWriter &, const T &);
+ *   bool debby_ecs_read(ecs::SnapshotReader &, T &);
+ *
+ * debby_ecs_read is handed a default constructed component. Entities
+ * held by a component carry a pointer to their registry, so they must
+ * be written as ids and given SnapshotReader::registry when read */
+template <typename TComponent, typename = void>
+constexpr bool has_serializer_v{false};
+
+template <typename TComponent>
+constexpr bool has_serializer_v<
+    TComponent,
+    std::void_t<decltype(debby_ecs_write(std::declval<SnapshotWriter &>(),
+                                         std::declval<const TComponent &>())),
+                decltype(debby_ecs_read(std::declval<SnapshotReader &>(),
+                                        std::declval<TComponent &>()))>>{
+    true};
+
+/* Whether components of the type can be part of a snapshot */
+template <typename TComponent>
+constexpr bool is_snapshot_v{
+    has_serializer_v<TComponent> ||
+    std::is_trivially_copyable_v<TComponent>};
+}  // namespace debby::ecs
+
+#endif  // DEBBY_ECS_SNAPSHOT_HPP_
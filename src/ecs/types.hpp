@@ -0,0 +1,291 @@
+#ifndef DEBBY_ECS_TYPES_HPP_
+#define DEBBY_ECS_TYPES_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "./signature.hpp"
+
+namespace debby::ecs {
+/* Universal ID type */
+using Id = unsigned int;
+
+/* Thread-safe ID counter */
+using IdCounter = std::atomic<Id>;
+
+/* Marks an empty slot in a sparse index or an invalid entity */
+constexpr Id INVALID_ID{std::numeric_limits<Id>::max()};
+
+/* Entity ids pack an index into the registry tables in the low
+ * bits and a generation in the high bits. The generation is bumped
+ * every time an index is recycled, such that stale copies of a
+ * destroyed entity never alias the entity that reuses its index */
+constexpr unsigned int ENTITY_INDEX_BITS{24};
+constexpr Id ENTITY_INDEX_MASK{(Id{1} << ENTITY_INDEX_BITS) - 1};
+constexpr Id ENTITY_GENERATION_MASK{INVALID_ID >> ENTITY_INDEX_BITS};
+
+/* Max number of live entities, the last index is reserved for INVALID_ID */
+constexpr Id MAX_ENTITIES{ENTITY_INDEX_MASK};
+
+[[nodiscard]] constexpr Id entity_index(Id entity_id) {
+    return entity_id & ENTITY_INDEX_MASK;
+}
+
+[[nodiscard]] constexpr Id entity_generation(Id entity_id) {
+    return entity_id >> ENTITY_INDEX_BITS;
+}
+
+[[nodiscard]] constexpr Id make_entity_id(Id index, Id generation) {
+    return ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) |
+           (index & ENTITY_INDEX_MASK);
+}
+
+/* Counts structural and component changes, the registry advances it
+ * every time a system runs. At one tick per system run it takes
+ * months of play for a 32-bit tick to wrap around */
+using Tick = std::uint32_t;
+
+/* Thread-safe tick counter */
+using TickCounter = std::atomic<Tick>;
+
+/* When a component was added to its entity and last changed */
+struct ComponentTicks {
+    Tick added;
+    Tick changed;
+};
+
+/*
+ * MemoryUsage describes the bytes held by a container, where used
+ * is what live elements occupy and reserved is what is allocated.
+ * Heap memory owned by the elements themselves is not included */
+struct MemoryUsage {
+    std::size_t used;
+    std::size_t reserved;
+
+    inline MemoryUsage &operator+=(const MemoryUsage &other) {
+        used += other.used;
+        reserved += other.reserved;
+        return *this;
+    }
+};
+
+/* Memory held by a vector of trivially sized elements */
+template <typename TVector>
+inline MemoryUsage get_memory_usage(const TVector &vector) {
+    using TValue = typename TVector::value_type;
+    return {vector.size() * sizeof(TValue),
+            vector.capacity() * sizeof(TValue)};
+}
+
+/* Components without any data are tags. They only live in the signature
+ * of their entities, so no storage is ever allocated for them */
+template <typename TComponent>
+constexpr bool is_tag_v{std::is_empty_v<TComponent>};
+
+/* Looked up by DEBBY_ECS_COMPONENT, never instantiated */
+template <typename TComponent>
+struct ComponentTag {};
+
+/* Number of ids reserved for DEBBY_ECS_COMPONENT, the
+ * remaining ones are handed out to types that are not registered */
+#ifndef DEBBY_ECS_MAX_REGISTERED
+#define DEBBY_ECS_MAX_REGISTERED 16
+#endif
+
+/* Number of ids reserved for registered component types */
+constexpr Id MAX_REGISTERED_COMPONENTS{DEBBY_ECS_MAX_REGISTERED};
+
+static_assert(MAX_REGISTERED_COMPONENTS < MAX_COMPONENTS,
+              "DEBBY_ECS_MAX_REGISTERED must be below the component count");
+
+/*
+ * Assigns a fixed id to a component type, such that looking it up costs
+ * nothing at runtime. Place it next to the type, in the same namespace.
+ * Every registered index must be unique, below DEBBY_ECS_MAX_REGISTERED,
+ * and 0 belongs to Disabled. Types that are not registered, resources
+ * included, get an id the first time it is used, counting down from the
+ * last one and never into the registered range */
+#define DEBBY_ECS_COMPONENT(TYPE, INDEX)                                  \
+    static_assert((INDEX) < ::debby::ecs::MAX_REGISTERED_COMPONENTS,     \
+                  "component index exceeds DEBBY_ECS_MAX_REGISTERED");   \
+    [[maybe_unused]] constexpr ::debby::ecs::Id debby_ecs_component_index( \
+        ::debby::ecs::ComponentTag<TYPE>) {                               \
+        return (INDEX);                                                   \
+    }
+
+/* True for component types registered with DEBBY_ECS_COMPONENT */
+template <typename TComponent, typename = void>
+constexpr bool is_registered_v{false};
+
+template <typename TComponent>
+constexpr bool is_registered_v<
+    TComponent, std::void_t<decltype(debby_ecs_component_index(
+                    ComponentTag<TComponent>{}))>>{true};
+
+/* Built-in tag of disabled entities, which systems and views skip */
+struct Disabled {};
+
+DEBBY_ECS_COMPONENT(Disabled, 0)
+
+/*
+ * IComponent is a simple wrapper to hold an ID counter */
+class IComponent {
+   protected:
+    static IdCounter _next_id;
+
+    /* Next id of a type that is not registered, aborts once every id
+     * above the registered range is taken, since the next one would
+     * share a pool and signature bit with a registered type */
+    [[nodiscard]] static Id _next_dynamic_id();
+};
+
+/*
+ * Component is an abstract class instantiated
+ * for once for each unique component subtype */
+template <typename TComponent>
+class Component : public IComponent {
+   public:
+    [[nodiscard]] inline static Id get_id() {
+        if constexpr (is_registered_v<TComponent>) {
+            return debby_ecs_component_index(ComponentTag<TComponent>{});
+        } else {
+            /* Since a unique component class is made for each type
+             * static id variable will only be created once per instance */
+            static const Id id{_next_dynamic_id()};
+            return id;
+        }
+    }
+};
+
+/* Signature with the bit of every one of TComponents set */
+template <typename... TComponents>
+[[nodiscard]] inline ComponentSignature make_signature() {
+    ComponentSignature signature{};
+    (signature.set(Component<TComponents>::get_id()), ...);
+    return signature;
+}
+
+/* Systems registered with DEBBY_ECS_SYSTEM take an index below this,
+ * the others are numbered from it on in the order they are first used */
+constexpr Id MAX_REGISTERED_SYSTEMS{32};
+
+/* Looked up by DEBBY_ECS_SYSTEM, never instantiated */
+template <typename TSystem>
+struct SystemTag {};
+
+/* Assigns a fixed id to a system type, which the registry uses to index
+ * its table of systems. Place it next to the type, in the same namespace */
+#define DEBBY_ECS_SYSTEM(TYPE, INDEX)                                      \
+    static_assert((INDEX) < ::debby::ecs::MAX_REGISTERED_SYSTEMS,         \
+                  "system index exceeds MAX_REGISTERED_SYSTEMS");         \
+    [[maybe_unused]] constexpr ::debby::ecs::Id debby_ecs_system_index(    \
+        ::debby::ecs::SystemTag<TYPE>) {                                   \
+        return (INDEX);                                                    \
+    }
+
+/* True for system types registered with DEBBY_ECS_SYSTEM */
+template <typename TSystem, typename = void>
+constexpr bool is_registered_system_v{false};
+
+template <typename TSystem>
+constexpr bool is_registered_system_v<
+    TSystem,
+    std::void_t<decltype(debby_ecs_system_index(SystemTag<TSystem>{}))>>{
+    true};
+
+/*
+ * ISystemType is a simple wrapper to hold an ID counter */
+class ISystemType {
+   protected:
+    static IdCounter _next_id;
+};
+
+/*
+ * SystemType is instantiated once for each unique system subtype */
+template <typename TSystem>
+class SystemType : public ISystemType {
+   public:
+    [[nodiscard]] inline static Id get_id() {
+        if constexpr (is_registered_system_v<TSystem>) {
+            return debby_ecs_system_index(SystemTag<TSystem>{});
+        } else {
+            static const Id id{_next_id++};
+            return id;
+        }
+    }
+};
+
+/* Copy-constructs count copies of prototype into uninitialized memory
+ * at dst. Trivially copyable components are copied with memcpy, in
+ * blocks that double in size, rather than one at a time */
+template <typename TComponent>
+inline void copy_construct_n(void *dst, const TComponent &prototype,
+                             std::size_t count) {
+    auto *items{static_cast<TComponent *>(dst)};
+    if constexpr (std::is_trivially_copyable_v<TComponent>) {
+        if (count == 0) {
+            return;
+        }
+        std::memcpy(items, &prototype, sizeof(TComponent));
+        for (std::size_t copied = 1; copied < count;) {
+            const std::size_t block{std::min(copied, count - copied)};
+            std::memcpy(items + copied, items, block * sizeof(TComponent));
+            copied += block;
+        }
+    } else {
+        for (std::size_t i = 0; i < count; i++) {
+            new (items + i) TComponent(prototype);
+        }
+    }
+}
+
+/*
+ * ComponentInfo describes how to handle a component type
+ * when only its id is known, i.e. when it is stored as raw
+ * bytes in an archetype chunk rather than in a typed pool */
+struct ComponentInfo {
+    Id id;
+    std::size_t size;
+    std::size_t alignment;
+
+    /* Move-constructs src into uninitialized dst and destroys src */
+    void (*relocate)(void *dst, void *src);
+    void (*destroy)(void *ptr);
+
+    /* Copy-constructs count copies of src into uninitialized dst,
+     * only valid for components that are copy constructible */
+    void (*copy)(void *dst, const void *src, std::size_t count);
+};
+
+template <typename TComponent>
+inline const ComponentInfo &get_component_info() {
+    static const ComponentInfo info{
+        Component<TComponent>::get_id(), sizeof(TComponent),
+        alignof(TComponent),
+        [](void *dst, void *src) {
+            auto *source{static_cast<TComponent *>(src)};
+            new (dst) TComponent(std::move(*source));
+            source->~TComponent();
+        },
+        [](void *ptr) { static_cast<TComponent *>(ptr)->~TComponent(); },
+        [](void *dst, const void *src, std::size_t count) {
+            if constexpr (std::is_copy_constructible_v<TComponent>) {
+                copy_construct_n(dst, *static_cast<const TComponent *>(src),
+                                 count);
+            } else {
+                assert(false && "component is not copy constructible");
+            }
+        }};
+    return info;
+}
+}  // namespace debby::ecs
+
+#endif  // DEBBY_ECS_TYPES_HPP_
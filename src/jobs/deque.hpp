@@ -0,0 +1,90 @@
+#ifndef DEBBY_JOBS_DEQUE_HPP_
+#define DEBBY_JOBS_DEQUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace debby::jobs {
+
+/*
+ * WorkStealingDeque is a fixed-capacity Chase-Lev deque. The owning
+ * thread pushes and pops at the bottom without taking any lock, while
+ * other threads steal from the top. Capacity must be a power of two */
+template <typename T>
+class WorkStealingDeque {
+   private:
+    std::unique_ptr<std::atomic<T *>[]> _buffer;
+    std::int64_t _mask;
+
+    /* Kept on separate cache lines, since thieves only touch _top */
+    alignas(64) std::atomic<std::int64_t> _top;
+    alignas(64) std::atomic<std::int64_t> _bottom;
+
+   public:
+    explicit WorkStealingDeque(std::size_t capacity)
+        : _buffer(std::make_unique<std::atomic<T *>[]>(capacity)),
+          _mask(static_cast<std::int64_t>(capacity) - 1),
+          _top(0),
+          _bottom(0) {}
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    /* Owner only, returns false if the deque is full */
+    inline bool push(T *item) {
+        const std::int64_t bottom{_bottom.load(std::memory_order_relaxed)};
+        const std::int64_t top{_top.load(std::memory_order_acquire)};
+        if (bottom - top > _mask) {
+            return false;
+        }
+        _buffer[bottom & _mask].store(item, std::memory_order_relaxed);
+        _bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Owner only, takes the most recently pushed item */
+    inline T *pop() {
+        const std::int64_t bottom{_bottom.load(std::memory_order_relaxed) -
+                                  1};
+        _bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t top{_top.load(std::memory_order_relaxed)};
+        if (top > bottom) {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T *item{_buffer[bottom & _mask].load(std::memory_order_relaxed)};
+        if (top == bottom) {
+            /* last item, race thieves for it */
+            if (!_top.compare_exchange_strong(top, top + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /* Any thread, takes the least recently pushed item */
+    inline T *steal() {
+        std::int64_t top{_top.load(std::memory_order_acquire)};
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t bottom{_bottom.load(std::memory_order_acquire)};
+        if (top >= bottom) {
+            return nullptr;
+        }
+        T *item{_buffer[top & _mask].load(std::memory_order_relaxed)};
+        if (!_top.compare_exchange_strong(top, top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+};
+}  // namespace debby::jobs
+
+#endif  // DEBBY_JOBS_DEQUE_HPP_
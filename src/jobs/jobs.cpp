@@ -0,0 +1,225 @@
+#include "jobs.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "./deque.hpp"
+
+using JobDeque = debby::jobs::WorkStealingDeque<debby::jobs::Job>;
+
+/* Jobs each thread can queue before it runs them inline instead */
+constexpr std::size_t DEQUE_CAPACITY{4096};
+
+/* Failed searches before a worker goes to sleep */
+constexpr int SPIN_COUNT{64};
+
+constexpr std::size_t NO_INDEX{std::numeric_limits<std::size_t>::max()};
+
+/* Index zero belongs to the thread that initialized the pool */
+static std::vector<std::unique_ptr<JobDeque>> deques{};
+static std::vector<std::thread> workers{};
+
+/* Jobs submitted by threads that do not own a deque */
+static std::deque<debby::jobs::Job *> injected{};
+static std::atomic<std::size_t> injected_count{0};
+
+/* Guards injected and sleeping workers */
+static std::mutex mutex{};
+static std::condition_variable condition{};
+
+/* Jobs submitted but not yet taken by any thread */
+static std::atomic<std::size_t> queued{0};
+static std::atomic<std::size_t> sleeping{0};
+static std::atomic<bool> is_stopping{false};
+
+static std::atomic<std::size_t> jobs_executed{0};
+static std::atomic<std::size_t> jobs_stolen{0};
+static std::atomic<std::size_t> jobs_inlined{0};
+static std::atomic<std::int64_t> idle_nanoseconds{0};
+
+static thread_local std::size_t thread_index{NO_INDEX};
+
+static void execute(const debby::jobs::Job &job) {
+    job.function(job);
+    jobs_executed.fetch_add(1, std::memory_order_relaxed);
+    job.counter->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+static debby::jobs::Job *find_job() {
+    debby::jobs::Job *job{nullptr};
+    if (thread_index != NO_INDEX) {
+        job = deques[thread_index]->pop();
+    }
+    if (!job && injected_count.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!injected.empty()) {
+            job = injected.front();
+            injected.pop_front();
+            injected_count.fetch_sub(1, std::memory_order_release);
+        }
+    }
+    if (!job) {
+        /* start at a different victim per thread to spread contention */
+        const std::size_t start{thread_index == NO_INDEX ? 0
+                                                         : thread_index + 1};
+        for (std::size_t i = 0; i < deques.size() && !job; i++) {
+            const std::size_t victim{(start + i) % deques.size()};
+            if (victim != thread_index) {
+                job = deques[victim]->steal();
+            }
+        }
+        if (job) {
+            jobs_stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (job) {
+        queued.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    return job;
+}
+
+static void work(std::size_t index) {
+    thread_index = index;
+    while (!is_stopping.load(std::memory_order_acquire)) {
+        debby::jobs::Job *job{find_job()};
+        if (job) {
+            execute(*job);
+            continue;
+        }
+        const auto idle_start{std::chrono::steady_clock::now()};
+        for (int i = 0; i < SPIN_COUNT && !job; i++) {
+            std::this_thread::yield();
+            job = find_job();
+        }
+        if (!job) {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            condition.wait(lock, [] {
+                return is_stopping.load() || queued.load() > 0;
+            });
+            sleeping.fetch_sub(1);
+        }
+        idle_nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - idle_start)
+                .count(),
+            std::memory_order_relaxed);
+        if (job) {
+            execute(*job);
+        }
+    }
+}
+
+void debby::jobs::initialize(unsigned int worker_count) {
+    if (is_running()) {
+        spdlog::warn("job system is already running");
+        return;
+    }
+    spdlog::debug("starting job system with {0:d} workers", worker_count);
+    is_stopping = false;
+    for (unsigned int i = 0; i <= worker_count; i++) {
+        deques.push_back(std::make_unique<JobDeque>(DEQUE_CAPACITY));
+    }
+    thread_index = 0;
+    for (unsigned int i = 1; i <= worker_count; i++) {
+        workers.emplace_back(work, i);
+    }
+    reset_stats();
+}
+
+void debby::jobs::destroy() {
+    if (!is_running()) {
+        return;
+    }
+    const Stats stats{get_stats()};
+    spdlog::debug(
+        "stopping job system, {0:d} jobs executed, {1:d} stolen, {2:d} "
+        "inlined, {3:d}ms idle",
+        stats.jobs_executed, stats.jobs_stolen, stats.jobs_inlined,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            stats.idle_time)
+            .count());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    deques.clear();
+    injected.clear();
+    injected_count = 0;
+    queued = 0;
+    thread_index = NO_INDEX;
+}
+
+bool debby::jobs::is_running() { return !deques.empty(); }
+
+unsigned int debby::jobs::get_thread_count() {
+    return static_cast<unsigned int>(deques.size());
+}
+
+void debby::jobs::submit(Job &job) {
+    job.counter->fetch_add(1, std::memory_order_relaxed);
+    if (!is_running()) {
+        jobs_inlined.fetch_add(1, std::memory_order_relaxed);
+        execute(job);
+        return;
+    }
+    /* counted before it is visible, such that a sleeping worker never
+     * misses a queued job. Sequentially consistent like the increment
+     * of sleeping by workers, such that either the worker sees the job
+     * or this sees the worker, whichever of the two comes last */
+    queued.fetch_add(1, std::memory_order_seq_cst);
+    if (thread_index != NO_INDEX) {
+        if (!deques[thread_index]->push(&job)) {
+            queued.fetch_sub(1, std::memory_order_acq_rel);
+            jobs_inlined.fetch_add(1, std::memory_order_relaxed);
+            execute(job);
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        injected.push_back(&job);
+        injected_count.fetch_add(1, std::memory_order_release);
+    }
+    if (sleeping.load(std::memory_order_seq_cst) > 0) {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        condition.notify_one();
+    }
+}
+
+void debby::jobs::wait(const Counter &counter) {
+    while (counter.load(std::memory_order_acquire) > 0) {
+        Job *job{is_running() ? find_job() : nullptr};
+        if (job) {
+            execute(*job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+debby::jobs::Stats debby::jobs::get_stats() {
+    return {static_cast<unsigned int>(workers.size()),
+            jobs_executed.load(std::memory_order_relaxed),
+            jobs_stolen.load(std::memory_order_relaxed),
+            jobs_inlined.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(
+                idle_nanoseconds.load(std::memory_order_relaxed))};
+}
+
+void debby::jobs::reset_stats() {
+    jobs_executed = 0;
+    jobs_stolen = 0;
+    jobs_inlined = 0;
+    idle_nanoseconds = 0;
+}
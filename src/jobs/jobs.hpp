@@ -0,0 +1,135 @@
+#ifndef DEBBY_JOBS_JOBS_HPP_
+#define DEBBY_JOBS_JOBS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace debby::jobs {
+
+/* Number of submitted jobs that have not finished yet */
+using Counter = std::atomic<std::size_t>;
+
+/*
+ * Job runs function over the range [begin, end). The job is owned
+ * by whoever submits it and must outlive its execution, which is
+ * guaranteed by waiting on its counter before releasing it */
+struct Job {
+    void (*function)(const Job &job);
+    void *data;
+    std::size_t begin;
+    std::size_t end;
+    Counter *counter;
+};
+
+/* Totals since the pool was started or the stats were last reset */
+struct Stats {
+    unsigned int worker_count;
+    std::size_t jobs_executed;
+    std::size_t jobs_stolen;
+
+    /* Jobs run directly by the submitting thread */
+    std::size_t jobs_inlined;
+
+    /* Summed over every worker */
+    std::chrono::nanoseconds idle_time;
+};
+
+/* Starts the worker threads. By default one less than the number of
+ * hardware threads, since the calling thread runs jobs while waiting */
+void initialize(unsigned int worker_count =
+                    std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+/* Stops and joins every worker */
+void destroy();
+
+[[nodiscard]] bool is_running();
+
+/* Workers plus the thread that initialized the pool */
+[[nodiscard]] unsigned int get_thread_count();
+
+/* Queues the job and increments its counter. The job is run
+ * immediately on the calling thread if the pool is not running */
+void submit(Job &job);
+
+/* Runs queued jobs until counter reaches zero */
+void wait(const Counter &counter);
+
+[[nodiscard]] Stats get_stats();
+
+void reset_stats();
+
+/*
+ * Splits the entities of view into ranges of chunk_size and calls
+ * fn(entity, components...) for each of them across every thread,
+ * returning once all ranges are done. fn is called concurrently and
+ * must only touch the components it was given. Views too small to
+ * fill more than one range run inline on the calling thread */
+template <typename TView, typename TFunc>
+void parallel_for(const TView &view, std::size_t chunk_size, TFunc &&fn) {
+    const std::size_t count{view.size_hint()};
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+    if (count <= chunk_size || get_thread_count() < 2) {
+        view.each(fn);
+        return;
+    }
+    struct Context {
+        const TView *view;
+        std::remove_reference_t<TFunc> *fn;
+    } context{&view, &fn};
+    Counter counter{0};
+    std::vector<Job> jobs{};
+    jobs.reserve((count + chunk_size - 1) / chunk_size);
+    for (std::size_t begin = 0; begin < count; begin += chunk_size) {
+        jobs.push_back({[](const Job &job) {
+                            const auto *ctx{static_cast<Context *>(job.data)};
+                            ctx->view->each(job.begin, job.end, *ctx->fn);
+                        },
+                        &context, begin, std::min(begin + chunk_size, count),
+                        &counter});
+    }
+    for (auto &job : jobs) {
+        submit(job);
+    }
+    wait(counter);
+}
+
+/*
+ * Splits [0, count) into ranges of chunk_size and calls fn(begin, end)
+ * for each of them across every thread, for data that is not reached
+ * through a view, such as arrays kept by a system */
+template <typename TFunc>
+void parallel_for_range(std::size_t count, std::size_t chunk_size,
+                        TFunc &&fn) {
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+    if (count <= chunk_size || get_thread_count() < 2) {
+        fn(std::size_t{0}, count);
+        return;
+    }
+    using Func = std::remove_reference_t<TFunc>;
+    /* Job::data is not const, but a const fn is only
+     * ever cast back to and called as const Func */
+    void *data{const_cast<void *>(static_cast<const void *>(&fn))};
+    Counter counter{0};
+    std::vector<Job> jobs{};
+    jobs.reserve((count + chunk_size - 1) / chunk_size);
+    for (std::size_t begin = 0; begin < count; begin += chunk_size) {
+        jobs.push_back({[](const Job &job) {
+                            (*static_cast<Func *>(job.data))(job.begin,
+                                                             job.end);
+                        },
+                        data, begin, std::min(begin + chunk_size, count),
+                        &counter});
+    }
+    for (auto &job : jobs) {
+        submit(job);
+    }
+    wait(counter);
+}
+}  // namespace debby::jobs
+
+#endif  // DEBBY_JOBS_JOBS_HPP_
@@ -1,11 +1,15 @@
 #include "game_manager.hpp"
 
 #include <SDL2/SDL_events.h>
+#include <SDL2/SDL_rect.h>
 #include <SDL2/SDL_timer.h>
 
 #include <cstdlib>
 #include <fstream>
 #include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include "../common/utils.hpp"
 #include "../components/animation_component.hpp"
@@ -14,27 +18,62 @@
 #include "../components/sprite_component.hpp"
 #include "../components/transform_component.hpp"
 #include "../ecs/ecs.hpp"
+#include "../ecs/scheduler.hpp"
+#include "../jobs/jobs.hpp"
 #include "../systems/animation_system.hpp"
 #include "../systems/collision_system.hpp"
 #include "../systems/collisiondebug_system.hpp"
 #include "../systems/damage_system.hpp"
+#include "../systems/hierarchy_system.hpp"
 #include "../systems/keyboardcontrol_system.hpp"
 #include "../systems/movement_system.hpp"
 #include "../systems/render_system.hpp"
 
-static bool is_running{false};
-static bool do_cap_frame_rate{false};
 static SDL_Event event{};
-static float previous_frame_time{};
-static debby::GameContext game_context{};
 
 static std::unique_ptr<debby::ecs::Registry> registry{
     std::make_unique<debby::ecs::Registry>()};
 
-static void cap_frame_rate() {
+/* runs the simulation systems on the job system */
+static std::unique_ptr<debby::ecs::Scheduler> scheduler{};
+
+/* Characters share a sprite sheet layout, with a walk animation per
+ * direction starting at walk_row and an attack animation per direction
+ * starting at row 5. Spawners instantiate the prefab as often as needed */
+static debby::ecs::Prefab make_character_prefab(const std::string &texture,
+                                                glm::vec2 position,
+                                                glm::vec2 velocity,
+                                                int walk_row,
+                                                int attack_frames,
+                                                const std::string &facing) {
+    debby::ecs::Prefab prefab{};
+    prefab.add_component<debby::TransformComponent>(position,
+                                                    glm::vec2(2.f, 2.f));
+    prefab.add_component<debby::RigidBodyComponent>(velocity);
+    prefab.add_component<debby::SpriteComponent>(texture, 16, 16, 2);
+    prefab.add_component<debby::BoxColliderComponent>(16, 16);
+
+    auto &anim{prefab.add_component<debby::AnimationComponent>()};
+    const std::string directions[]{"down", "up", "right", "left"};
+    for (int i = 0; i < 4; i++) {
+        anim.add_animation(directions[i], debby::AnimationContext{
+                                              5, walk_row + i, 5, true});
+    }
+    for (int i = 0; i < 4; i++) {
+        anim.add_animation("attack-" + directions[i],
+                           debby::AnimationContext{attack_frames, 5 + i, 5,
+                                                   false});
+    }
+    anim.set_active_animation(facing);
+    anim.start();
+    return prefab;
+}
+
+static void cap_frame_rate(const debby::GameContext &game_context) {
     int time_to_wait = static_cast<int>(
         debby::constants::FRAME_TARGET -
-        (static_cast<float>(SDL_GetTicks()) - previous_frame_time));
+        (static_cast<float>(SDL_GetTicks()) -
+         static_cast<float>(game_context.ticks)));
     // only delay if too fast
     if (time_to_wait > 0 && time_to_wait < debby::constants::FRAME_TARGET) {
         SDL_Delay(time_to_wait);
@@ -42,42 +81,64 @@ static void cap_frame_rate() {
 }
 
 static void calculate_delta_time() {
-    if (do_cap_frame_rate) {
-        cap_frame_rate();
+    auto &game_context{registry->resource<debby::GameContext>()};
+    if (game_context.do_cap_frame_rate) {
+        cap_frame_rate(game_context);
     }
     // calculate delta time
-    auto delta_time =
-        (static_cast<float>(SDL_GetTicks()) - previous_frame_time) / 1000.f;
+    auto delta_time = (static_cast<float>(SDL_GetTicks()) -
+                       static_cast<float>(game_context.ticks)) /
+                      1000.f;
     // clamp value (if running in debugger dt will be messed up)
     game_context.delta_time =
         (debby::utils::greater(delta_time, debby::constants::MAXIMUM_DT))
             ? debby::constants::MAXIMUM_DT
             : delta_time;
     // update previous frame time
-    previous_frame_time = static_cast<float>(SDL_GetTicks());
+    game_context.ticks = SDL_GetTicks();
 }
 
 bool debby::managers::game::initialize() {
     if (!screen::initialize()) {
         return false;
     }
-    is_running = true;
+    auto &game_context{registry->set_resource<GameContext>()};
+    game_context.ticks = SDL_GetTicks();
+    game_context.is_running = true;
     return true;
 }
 
 void debby::managers::game::setup() {
+    /* systems of a phase are added in the order they must run in */
+    registry->add_system<DamageSystem>();
+    registry->add_system<KeyboardControlSystem>();
     registry->add_system<MovementSystem>();
-    registry->add_system<RenderSystem>();
+    registry->add_system<HierarchySystem>();
     registry->add_system<AnimationSystem>();
     registry->add_system<CollisionSystem>();
+    registry->add_system<RenderSystem>();
     registry->add_system<CollisionDebugSystem>();
-    registry->add_system<DamageSystem>();
-    registry->add_system<KeyboardControlSystem>();
+    registry->get_system<CollisionDebugSystem>().set_enabled(
+        registry->resource<GameContext>().draw_collision_rects);
+
+    jobs::initialize();
+
+    /* conflicting simulation systems keep the order they were added in */
+    scheduler = std::make_unique<ecs::Scheduler>();
+    for (ecs::System *system : registry->get_systems(ecs::Phase::simulate)) {
+        scheduler->add(*system, [system] {
+            system->update(
+                system->registry->resource<GameContext>().delta_time);
+        });
+    }
 
     load_level(1);
 }
 
 void debby::managers::game::load_level(int level) {
+    /* entities of the previous level are released in bulk */
+    registry->clear();
+
     asset::add_texture("zhinja", "./assets/sprites/zhinja.png");
     asset::add_texture("grum", "./assets/sprites/grum.png");
 
@@ -90,6 +151,8 @@ void debby::managers::game::load_level(int level) {
         std::fstream map_file;
         map_file.open("./assets/tilemaps/jungle.map");
 
+        std::vector<SDL_Point> tile_sources{};
+        tile_sources.reserve(map_rows * map_cols);
         for (int y = 0; y < map_rows; y++) {
             for (int x = 0; x < map_cols; x++) {
                 char ch;
@@ -98,62 +161,38 @@ void debby::managers::game::load_level(int level) {
                 map_file.get(ch);
                 int src_x{std::strtol(&ch, nullptr, 10) * tile_size};
                 map_file.ignore();
-
-                ecs::Entity tile{registry->create_entity()};
-                tile.add_component<TransformComponent>(
-                    glm::vec2(x * (tile_size * tile_scale),
-                              y * (tile_size * tile_scale)),
-                    glm::vec2(tile_scale, tile_scale));
-                tile.add_component<SpriteComponent>("tilemap", tile_size,
-                                                    tile_size, 0, src_x, src_y);
+                tile_sources.push_back({src_x, src_y});
             }
         }
+
+        const auto tiles{registry->create_entities(tile_sources.size())};
+        registry->emplace_components<TransformComponent, SpriteComponent>(
+            tiles, [&](std::size_t i, ecs::Entity) {
+                const int x{static_cast<int>(i) % map_cols};
+                const int y{static_cast<int>(i) / map_cols};
+                return std::make_tuple(
+                    TransformComponent(
+                        glm::vec2(x * (tile_size * tile_scale),
+                                  y * (tile_size * tile_scale)),
+                        glm::vec2(tile_scale, tile_scale)),
+                    SpriteComponent("tilemap", tile_size, tile_size, 0,
+                                    tile_sources[i].x, tile_sources[i].y));
+            });
     }
 
-    ecs::Entity zhinja{registry->create_entity()};
-
-    zhinja.add_component<TransformComponent>(glm::vec2(40.f, 50.f),
-                                             glm::vec2(2.f, 2.f));
-    zhinja.add_component<RigidBodyComponent>(glm::vec2(10.f, 0.f));
-    zhinja.add_component<SpriteComponent>("zhinja", 16, 16, 2);
-    zhinja.add_component<BoxColliderComponent>(16, 16);
-
-    auto &anim{zhinja.add_component<AnimationComponent>()};
-    anim.add_animation("down", AnimationContext{5, 1, 5, true});
-    anim.add_animation("up", AnimationContext{5, 2, 5, true});
-    anim.add_animation("right", AnimationContext{5, 3, 5, true});
-    anim.add_animation("left", AnimationContext{5, 4, 5, true});
-    anim.add_animation("attack-down", AnimationContext{5, 5, 5, false});
-    anim.add_animation("attack-up", AnimationContext{5, 6, 5, false});
-    anim.add_animation("attack-right", AnimationContext{5, 7, 5, false});
-    anim.add_animation("attack-left", AnimationContext{5, 8, 5, false});
-    anim.set_active_animation("right");
-    anim.start();
+    const ecs::Prefab zhinja{make_character_prefab(
+        "zhinja", glm::vec2(40.f, 50.f), glm::vec2(10.f, 0.f), 1, 5, "right")};
+    registry->instantiate(zhinja);
 
-    ecs::Entity grum{registry->create_entity()};
-
-    grum.add_component<TransformComponent>(glm::vec2(100.f, 50.f),
-                                           glm::vec2(2.f, 2.f));
-    grum.add_component<RigidBodyComponent>(glm::vec2(-10.f, 0.f));
-    grum.add_component<SpriteComponent>("grum", 16, 16, 2);
-    grum.add_component<BoxColliderComponent>(16, 16);
-
-    auto &anim2{grum.add_component<AnimationComponent>()};
-    anim2.add_animation("down", AnimationContext{5, 0, 5, true});
-    anim2.add_animation("up", AnimationContext{5, 1, 5, true});
-    anim2.add_animation("right", AnimationContext{5, 2, 5, true});
-    anim2.add_animation("left", AnimationContext{5, 3, 5, true});
-    anim2.add_animation("attack-down", AnimationContext{3, 5, 5, false});
-    anim2.add_animation("attack-up", AnimationContext{3, 6, 5, false});
-    anim2.add_animation("attack-right", AnimationContext{3, 7, 5, false});
-    anim2.add_animation("attack-left", AnimationContext{3, 8, 5, false});
-    anim2.set_active_animation("left");
-    anim2.start();
+    const ecs::Prefab grum{make_character_prefab(
+        "grum", glm::vec2(100.f, 50.f), glm::vec2(-10.f, 0.f), 0, 3, "left")};
+    registry->instantiate(grum);
 }
 
 void debby::managers::game::run() {
     setup();
-    while (is_running) {
+    const auto &game_context{registry->resource<GameContext>()};
+    while (game_context.is_running) {
         process_input();
         update();
         render();
@@ -161,18 +200,21 @@ void debby::managers::game::run() {
 }
 
 void debby::managers::game::process_input() {
+    auto &game_context{registry->resource<GameContext>()};
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
             case SDL_QUIT:
-                is_running = false;
+                game_context.is_running = false;
                 break;
             case SDL_KEYDOWN:
                 if (event.key.keysym.sym == SDLK_d) {
                     game_context.draw_collision_rects =
                         !game_context.draw_collision_rects;
+                    registry->get_system<CollisionDebugSystem>().set_enabled(
+                        game_context.draw_collision_rects);
                 }
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
-                    is_running = false;
+                    game_context.is_running = false;
                 }
                 EventManager::emit<KeyPressedEvent>(event.key.keysym.sym);
                 break;
@@ -186,12 +228,10 @@ void debby::managers::game::update() {
     // TODO probably rethink this and make a "disconnect" method instead
     EventManager::reset();
 
-    registry->get_system<DamageSystem>().subscribe_to_events();
-    registry->get_system<KeyboardControlSystem>().subscribe_to_events();
+    registry->run_systems(ecs::Phase::input,
+                          registry->resource<GameContext>().delta_time);
 
-    registry->get_system<MovementSystem>().update(game_context.delta_time);
-    registry->get_system<AnimationSystem>().update();
-    registry->get_system<CollisionSystem>().update();
+    scheduler->run();
 
     registry->update();
 }
@@ -199,16 +239,15 @@ void debby::managers::game::update() {
 void debby::managers::game::render() {
     screen::clear();
 
-    registry->get_system<RenderSystem>().update();
-
-    if (game_context.draw_collision_rects) {
-        registry->get_system<CollisionDebugSystem>().update();
-    }
+    registry->run_systems(ecs::Phase::render,
+                          registry->resource<GameContext>().delta_time);
 
     screen::present();
 }
 
 void debby::managers::game::destroy() {
+    scheduler.reset();
+    jobs::destroy();
     asset::destroy();
     screen::destroy();
 }
@@ -1,9 +1,13 @@
 #ifndef DEBBY_SYSTEMS_ANIMATION_SYSTEM_HPP_
 #define DEBBY_SYSTEMS_ANIMATION_SYSTEM_HPP_
 
+#include <algorithm>
+
+#include "../common/globals.hpp"
 #include "../components/animation_component.hpp"
 #include "../components/sprite_component.hpp"
 #include "../ecs/ecs.hpp"
+#include "../jobs/jobs.hpp"
 
 namespace debby {
 
@@ -15,38 +19,54 @@ namespace debby {
 class AnimationSystem : public ecs::System {
    public:
     AnimationSystem() {
-        require_component<SpriteComponent>();
-        require_component<AnimationComponent>();
+        require_component<SpriteComponent>(ecs::Access::write);
+        require_component<AnimationComponent>(ecs::Access::write);
+        access_resource<GameContext>(ecs::Access::read);
     }
 
-    inline void update() {
-        for (auto entity : get_entities()) {
-            auto &anim{entity.get_component<AnimationComponent>()};
-            auto &active_anim{anim.get_active_animation()};
-            auto &sprite{entity.get_component<SpriteComponent>()};
-
-            // TODO probably tidy this up a bit
-            if (anim.is_started()) {
-                auto new_frame{
-                    static_cast<int>((SDL_GetTicks() - active_anim.start_time) *
-                                     active_anim.frame_rate / 1000)};
-                if (new_frame > active_anim.num_frames && !active_anim.loop) {
-                    active_anim.current_frame = 0;
-                    anim.stop();
+    inline void update(float delta_time) override {
+        /* every entity animates against the same frame time */
+        const auto ticks{
+            static_cast<int>(registry->resource<GameContext>().ticks)};
+        jobs::parallel_for(
+            registry->view<SpriteComponent, AnimationComponent>(),
+            constants::JOB_CHUNK_SIZE,
+            [this, ticks](ecs::Entity entity, SpriteComponent &sprite,
+                          AnimationComponent &anim) {
+                auto &active_anim{anim.get_active_animation()};
+
+                // TODO probably tidy this up a bit
+                if (anim.is_started()) {
+                    /* animations started during this frame begin after
+                     * the ticks were sampled */
+                    const int elapsed{
+                        std::max(ticks - active_anim.start_time, 0)};
+                    auto new_frame{elapsed * active_anim.frame_rate / 1000};
+                    if (new_frame > active_anim.num_frames &&
+                        !active_anim.loop) {
+                        active_anim.current_frame = 0;
+                        anim.stop();
+                    } else {
+                        active_anim.current_frame =
+                            new_frame % active_anim.num_frames;
+                    }
+
                 } else {
-                    active_anim.current_frame =
-                        new_frame % active_anim.num_frames;
+                    active_anim.current_frame = 0;
                 }
 
-            } else {
-                active_anim.current_frame = 0;
-            }
-
-            sprite.src_x = active_anim.current_frame * sprite.width;
-            sprite.src_y = active_anim.start_y * sprite.width;
-        }
+                const int src_x{active_anim.current_frame * sprite.width};
+                const int src_y{active_anim.start_y * sprite.width};
+                if (src_x != sprite.src_x || src_y != sprite.src_y) {
+                    sprite.src_x = src_x;
+                    sprite.src_y = src_y;
+                    registry->mark_changed<SpriteComponent>(entity);
+                }
+            });
     }
 };
+
+DEBBY_ECS_SYSTEM(AnimationSystem, 2)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_ANIMATION_SYSTEM_HPP_
@@ -4,8 +4,11 @@
 #include <SDL2/SDL_rect.h>
 #include <spdlog/spdlog.h>
 
+#include <vector>
+
 #include "../components/boxcollider_component.hpp"
 #include "../components/transform_component.hpp"
+#include "../components/worldtransform_component.hpp"
 #include "../ecs/ecs.hpp"
 #include "../events/collision_event.hpp"
 #include "../managers/event_manager.hpp"
@@ -16,52 +19,59 @@ namespace debby {
  *
  * Entities must have the following components:
  * - BoxColliderComponent
- * - TransformComponent */
+ * - TransformComponent
+ *
+ * The WorldTransformComponent is used instead of the
+ * TransformComponent for entities that have one */
 class CollisionSystem : public ecs::System {
+   private:
+    struct Collider {
+        ecs::Entity entity;
+        SDL_Rect rect;
+    };
+
+    /* kept between frames to avoid reallocating each update */
+    std::vector<Collider> _colliders;
+
    public:
     CollisionSystem() {
-        require_component<BoxColliderComponent>();
-        require_component<TransformComponent>();
+        require_component<BoxColliderComponent>(ecs::Access::read);
+        require_component<TransformComponent>(ecs::Access::read);
+        access_component<WorldTransformComponent>(ecs::Access::read);
     }
 
-    inline void update() {
-        auto entities{get_entities()};
-        for (auto i = entities.begin(); i != entities.end(); i++) {
-            ecs::Entity a{*i};
-            auto &a_collider{a.get_component<BoxColliderComponent>()};
-            auto a_transform{a.get_component<TransformComponent>()};
-            SDL_Rect a_rect{
-                static_cast<int>(a_transform.position.x +
-                                 a_collider.offset.x * a_transform.scale.x),
-                static_cast<int>(a_transform.position.y +
-                                 a_collider.offset.y * a_transform.scale.y),
-                a_collider.width * static_cast<int>(a_transform.scale.x),
-                a_collider.height * static_cast<int>(a_transform.scale.y),
-            };
-            for (auto j = i; j != entities.end(); j++) {
-                ecs::Entity b{*j};
-                if (a == b) {
-                    continue;
-                }
-                auto &b_collider{b.get_component<BoxColliderComponent>()};
-                auto b_transform{b.get_component<TransformComponent>()};
-                SDL_Rect b_rect{
-                    static_cast<int>(
-                        b_transform.position.x +
-                        (b_collider.offset.x * b_transform.scale.x)),
-                    static_cast<int>(
-                        b_transform.position.y +
-                        (b_collider.offset.y * b_transform.scale.y)),
-                    b_collider.width * static_cast<int>(b_transform.scale.x),
-                    b_collider.height * static_cast<int>(b_transform.scale.y),
+    inline void update(float delta_time) override {
+        _colliders.clear();
+        const auto *worlds{registry->get_pool<WorldTransformComponent>()};
+        registry->view<BoxColliderComponent, TransformComponent>().each(
+            [this, worlds](ecs::Entity entity,
+                           const BoxColliderComponent &collider,
+                           const TransformComponent &local) {
+                const TransformComponent &transform{
+                    worlds && worlds->contains(entity.get_id())
+                        ? worlds->get_item(entity.get_id())
+                        : local};
+                SDL_Rect rect{
+                    static_cast<int>(transform.position.x +
+                                     collider.offset.x * transform.scale.x),
+                    static_cast<int>(transform.position.y +
+                                     collider.offset.y * transform.scale.y),
+                    collider.width * static_cast<int>(transform.scale.x),
+                    collider.height * static_cast<int>(transform.scale.y),
                 };
-                if (SDL_HasIntersection(&a_rect, &b_rect)) {
-                    EventManager::emit<CollisionEvent>(a, b);
+                _colliders.push_back({entity, rect});
+            });
+        for (auto i = _colliders.begin(); i != _colliders.end(); i++) {
+            for (auto j = i + 1; j != _colliders.end(); j++) {
+                if (SDL_HasIntersection(&i->rect, &j->rect)) {
+                    EventManager::emit<CollisionEvent>(i->entity, j->entity);
                 }
             }
         }
     }
 };
+
+DEBBY_ECS_SYSTEM(CollisionSystem, 3)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_COLLISION_SYSTEM_HPP_
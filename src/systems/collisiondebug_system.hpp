@@ -4,9 +4,12 @@
 #include <SDL2/SDL_rect.h>
 #include <spdlog/spdlog.h>
 
+#include <utility>
+
 #include "../common/globals.hpp"
 #include "../components/boxcollider_component.hpp"
 #include "../components/transform_component.hpp"
+#include "../components/worldtransform_component.hpp"
 #include "../ecs/ecs.hpp"
 #include "../managers/screen_manager.hpp"
 
@@ -16,28 +19,41 @@ namespace debby {
  *
  * Entities must have the following components:
  * - BoxColliderComponent
- * - TransformComponent */
+ * - TransformComponent
+ *
+ * The WorldTransformComponent is used instead of the
+ * TransformComponent for entities that have one */
 class CollisionDebugSystem : public ecs::System {
    public:
     CollisionDebugSystem() {
-        require_component<BoxColliderComponent>();
-        require_component<TransformComponent>();
+        set_phase(ecs::Phase::render);
+        require_component<BoxColliderComponent>(ecs::Access::read);
+        require_component<TransformComponent>(ecs::Access::read);
+        access_component<WorldTransformComponent>(ecs::Access::read);
     }
 
-    inline void update() {
-        for (auto entity : get_entities()) {
-            auto collider{entity.get_component<BoxColliderComponent>()};
-            auto transform{entity.get_component<TransformComponent>()};
+    inline void update(float delta_time) override {
+        managers::screen::set_draw_color(color::green);
+        const auto *worlds{registry->get_pool<WorldTransformComponent>()};
+        for (auto [entity, collider, local] :
+             registry->view<BoxColliderComponent, TransformComponent>()) {
+            const TransformComponent &transform{
+                worlds && worlds->contains(entity.get_id())
+                    ? worlds->get_item(entity.get_id())
+                    : std::as_const(local)};
             SDL_Rect rect{
-                static_cast<int>(transform.position.x),
-                static_cast<int>(transform.position.y),
+                static_cast<int>(transform.position.x +
+                                 collider.offset.x * transform.scale.x),
+                static_cast<int>(transform.position.y +
+                                 collider.offset.y * transform.scale.y),
                 collider.width * static_cast<int>(transform.scale.x),
                 collider.height * static_cast<int>(transform.scale.y)};
-            managers::screen::set_draw_color(color::green);
             SDL_RenderDrawRect(managers::screen::get_renderer(), &rect);
         }
     }
 };
+
+DEBBY_ECS_SYSTEM(CollisionDebugSystem, 4)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_COLLISIONDEBUG_SYSTEM_HPP_
@@ -12,7 +12,10 @@ namespace debby {
 
 class DamageSystem : public ecs::System {
    public:
-    DamageSystem() { require_component<BoxColliderComponent>(); }
+    DamageSystem() {
+        set_phase(ecs::Phase::input);
+        require_component<BoxColliderComponent>(ecs::Access::read);
+    }
 
     inline void subscribe_to_events() {
         EventManager::connect<CollisionEvent>(this,
@@ -22,13 +25,19 @@ class DamageSystem : public ecs::System {
     inline void on_collision(CollisionEvent &event) {
         // TODO remove this test code
         spdlog::debug("DamageSystem: collision {0:d} -> {1:d}",
-                      event.a.get_id(), event.b.get_id());
-        event.a.kill();
-        event.b.kill();
+                      event.a.get_index(), event.b.get_index());
+        /* collisions are emitted while systems run, so the
+         * entities are destroyed when the registry updates */
+        auto &commands{registry->get_command_buffer()};
+        commands.destroy_entity(event.a);
+        commands.destroy_entity(event.b);
     }
 
-    inline void update() {}
+    /* events are disconnected at the start of every frame */
+    inline void update(float delta_time) override { subscribe_to_events(); }
 };
+
+DEBBY_ECS_SYSTEM(DamageSystem, 5)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_DAMAGE_SYSTEM_HPP_
@@ -0,0 +1,264 @@
+#ifndef DEBBY_SYSTEMS_HIERARCHY_SYSTEM_HPP_
+#define DEBBY_SYSTEMS_HIERARCHY_SYSTEM_HPP_
+
+#include <spdlog/spdlog.h>
+
+#include <glm/trigonometric.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "../components/parent_component.hpp"
+#include "../components/transform_component.hpp"
+#include "../components/worldtransform_component.hpp"
+#include "../ecs/ecs.hpp"
+
+namespace debby {
+
+/* HierarchySystem computes world transforms from local transforms
+ *
+ * Entities must have the following components:
+ * - TransformComponent
+ * - WorldTransformComponent
+ *
+ * Entities that also have a ParentComponent are placed relative to
+ * their parent. The ParentComponent pool is kept sorted by depth and
+ * then by parent, so every parent is visited before its children and
+ * a single sweep propagates changes down the hierarchy, while the
+ * children of a parent sit next to each other. Only entities whose
+ * local transform or parent changed since the last run, that were
+ * given a world transform, or whose parent world transform was
+ * recomputed, appeared or disappeared, are recomputed. Children are
+ * only propagated with pool storage */
+class HierarchySystem : public ecs::System {
+   private:
+    /* Parent each world transform was last computed
+     * from per entity index, or INVALID_ID for none */
+    std::vector<ecs::Id> _bound_parents;
+
+    /* Entities whose world transform was last computed from a parent */
+    std::vector<ecs::Id> _bound;
+
+    /* Size of the ParentComponent pool when depths were last computed */
+    ecs::Id _sorted_size;
+
+    /* Whether the depths were last computed with a parent cycle, which
+     * is only reported when it appears rather than on every frame */
+    bool _has_cycle;
+
+    /* kept between frames to avoid reallocating each update */
+    std::vector<ecs::Id> _changed;
+
+    static inline bool _by_depth(const ParentComponent &a,
+                                 const ParentComponent &b) {
+        if (a.depth != b.depth) {
+            return a.depth < b.depth;
+        }
+        return a.parent.get_id() < b.parent.get_id();
+    }
+
+    /* Applies the world transform of the parent to a local transform */
+    static inline WorldTransformComponent _combine(
+        const TransformComponent &parent, const TransformComponent &local) {
+        const auto radians{static_cast<float>(glm::radians(parent.rotation))};
+        const float cos{std::cos(radians)};
+        const float sin{std::sin(radians)};
+        const glm::vec2 offset{local.position * parent.scale};
+        return WorldTransformComponent(
+            parent.position + glm::vec2{offset.x * cos - offset.y * sin,
+                                        offset.x * sin + offset.y * cos},
+            parent.scale * local.scale, parent.rotation + local.rotation);
+    }
+
+    [[nodiscard]] inline ecs::Id _get_bound_parent(ecs::Id entity_id) const {
+        const ecs::Id index{ecs::entity_index(entity_id)};
+        return index < _bound_parents.size() ? _bound_parents[index]
+                                             : ecs::INVALID_ID;
+    }
+
+    inline void _set_bound_parent(ecs::Id entity_id, ecs::Id parent_id) {
+        const ecs::Id index{ecs::entity_index(entity_id)};
+        if (index >= _bound_parents.size()) {
+            _bound_parents.resize(index + 1, ecs::INVALID_ID);
+        }
+        _bound_parents[index] = parent_id;
+    }
+
+    /* Recomputes every depth if any parent was set or removed since the
+     * last run, and restores the order, which removals may also break */
+    void _sort(ecs::Pool<ParentComponent> &parents, ecs::Tick last_run) {
+        const ecs::Id *entities{parents.get_entities()};
+        const ecs::Id size{parents.get_size()};
+        /* a removal shrinks the pool, unless something was
+         * also added, which has a newer change tick */
+        _changed.clear();
+        if (size == _sorted_size) {
+            parents.collect_updated(last_run, _changed);
+        }
+        if (size != _sorted_size || !_changed.empty()) {
+            bool has_cycle{false};
+            for (ecs::Id slot = 0; slot < size; slot++) {
+                int depth{1};
+                ecs::Id ancestor{parents.at(slot).parent.get_id()};
+                while (parents.contains(ancestor) &&
+                       depth <= static_cast<int>(size)) {
+                    ancestor = parents.get_item(ancestor).parent.get_id();
+                    depth++;
+                }
+                if (depth > static_cast<int>(size)) {
+                    if (!_has_cycle) {
+                        spdlog::error("entity {0:d} is its own ancestor",
+                                      ecs::entity_index(entities[slot]));
+                    }
+                    has_cycle = true;
+                }
+                parents.at(slot).depth = depth;
+            }
+            _has_cycle = has_cycle;
+        }
+        _sorted_size = size;
+        for (ecs::Id slot = 1; slot < size; slot++) {
+            if (_by_depth(parents.at(slot), parents.at(slot - 1))) {
+                parents.sort(_by_depth);
+                break;
+            }
+        }
+    }
+
+    /* Entities that lost their ParentComponent become roots again */
+    void _detach(const ecs::Pool<ParentComponent> *parents,
+                 const ecs::Pool<TransformComponent> &transforms,
+                 ecs::Pool<WorldTransformComponent> &worlds) {
+        for (const ecs::Id entity_id : _bound) {
+            if ((parents && parents->contains(entity_id)) ||
+                !transforms.contains(entity_id) ||
+                !worlds.contains(entity_id)) {
+                continue;
+            }
+            const TransformComponent &local{transforms.get_item(entity_id)};
+            worlds.get_item(entity_id) = WorldTransformComponent(
+                local.position, local.scale, local.rotation);
+            worlds.mark_changed(entity_id);
+            _set_bound_parent(entity_id, ecs::INVALID_ID);
+        }
+        _bound.clear();
+    }
+
+   public:
+    HierarchySystem()
+        : _bound_parents({}),
+          _bound({}),
+          _sorted_size(0),
+          _has_cycle(false),
+          _changed({}) {
+        require_component<TransformComponent>(ecs::Access::read);
+        require_component<WorldTransformComponent>(ecs::Access::write);
+        /* depths are written while sorting */
+        access_component<ParentComponent>(ecs::Access::write);
+    }
+
+    /* Calls fn with each child of parent, in storage order. Reflects
+     * the hierarchy as of the last update, since it relies on the
+     * depths and the order maintained by it */
+    template <typename TFunc>
+    inline void each_child(ecs::Entity parent, TFunc &&fn) const {
+        const auto *parents{registry->get_pool<ParentComponent>()};
+        if (!parents) {
+            return;
+        }
+        ParentComponent key{parent};
+        if (parents->contains(parent.get_id())) {
+            key.depth = parents->get_item(parent.get_id()).depth + 1;
+        }
+        const ecs::Id *entities{parents->get_entities()};
+        ecs::Id begin{0};
+        ecs::Id end{parents->get_size()};
+        while (begin < end) {
+            const ecs::Id middle{begin + (end - begin) / 2};
+            if (_by_depth(parents->at(middle), key)) {
+                begin = middle + 1;
+            } else {
+                end = middle;
+            }
+        }
+        for (ecs::Id slot = begin; slot < parents->get_size() &&
+                                   !_by_depth(key, parents->at(slot));
+             slot++) {
+            ecs::Entity child{entities[slot]};
+            child.registry = registry;
+            fn(child);
+        }
+    }
+
+    inline void update(float delta_time) override {
+        const ecs::Tick last_run{begin_run()};
+        const auto reset_root{[this](ecs::Entity entity,
+                                     const TransformComponent &local,
+                                     WorldTransformComponent &world) {
+            world = WorldTransformComponent(local.position, local.scale,
+                                            local.rotation);
+            registry->mark_changed<WorldTransformComponent>(entity);
+        }};
+        const auto roots{
+            registry->view<TransformComponent, WorldTransformComponent>()
+                .without<ParentComponent>()};
+        roots.changed<TransformComponent>(last_run).each(reset_root);
+        /* a world transform added after its local one changed */
+        roots.added<WorldTransformComponent>(last_run).each(reset_root);
+
+        auto *parents{registry->get_pool<ParentComponent>()};
+        const auto *transforms{registry->get_pool<TransformComponent>()};
+        auto *worlds{registry->get_pool<WorldTransformComponent>()};
+        if (!transforms || !worlds) {
+            return;
+        }
+        _detach(parents, *transforms, *worlds);
+        if (!parents || parents->is_empty()) {
+            _sorted_size = 0;
+            return;
+        }
+        _sort(*parents, last_run);
+        /* parent world transforms are only written by this system,
+         * so only those written during this run are relevant */
+        const ecs::Tick this_run{get_last_run()};
+        const ecs::Id *entities{parents->get_entities()};
+        for (ecs::Id slot = 0; slot < parents->get_size(); slot++) {
+            const ecs::Id entity_id{entities[slot]};
+            if (!transforms->contains(entity_id) ||
+                !worlds->contains(entity_id)) {
+                continue;
+            }
+            const ecs::Id parent_id{parents->at(slot).parent.get_id()};
+            const bool has_parent{worlds->contains(parent_id)};
+            const ecs::Id bound_id{has_parent ? parent_id : ecs::INVALID_ID};
+            if (has_parent) {
+                _bound.push_back(entity_id);
+            }
+            /* a parent that was destroyed or lost its world
+             * transform leaves no change tick behind */
+            if (transforms->get_ticks(entity_id).changed <= last_run &&
+                parents->get_ticks(entity_id).changed <= last_run &&
+                worlds->get_ticks(entity_id).added <= last_run &&
+                _get_bound_parent(entity_id) == bound_id &&
+                (!has_parent ||
+                 worlds->get_ticks(parent_id).changed <= this_run)) {
+                continue;
+            }
+            const TransformComponent &local{transforms->get_item(entity_id)};
+            WorldTransformComponent &world{worlds->get_item(entity_id)};
+            if (has_parent) {
+                world = _combine(worlds->get_item(parent_id), local);
+            } else {
+                world = WorldTransformComponent(local.position, local.scale,
+                                                local.rotation);
+            }
+            worlds->mark_changed(entity_id);
+            _set_bound_parent(entity_id, bound_id);
+        }
+    }
+};
+
+DEBBY_ECS_SYSTEM(HierarchySystem, 7)
+}  // namespace debby
+
+#endif  // DEBBY_SYSTEMS_HIERARCHY_SYSTEM_HPP_
@@ -11,7 +11,7 @@ namespace debby {
 
 class KeyboardControlSystem : public ecs::System {
    public:
-    KeyboardControlSystem() {}
+    KeyboardControlSystem() { set_phase(ecs::Phase::input); }
 
     inline void subscribe_to_events() {
         EventManager::connect<KeyPressedEvent>(
@@ -23,8 +23,11 @@ class KeyboardControlSystem : public ecs::System {
                       static_cast<char>(event.symbol));
     }
 
-    inline void update() {}
+    /* events are disconnected at the start of every frame */
+    inline void update(float delta_time) override { subscribe_to_events(); }
 };
+
+DEBBY_ECS_SYSTEM(KeyboardControlSystem, 6)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_KEYBOARDCONTROL_SYSTEM_HPP_
@@ -1,9 +1,11 @@
 #ifndef DEBBY_SYSTEMS_MOVEMENT_SYSTEM_HPP_
 #define DEBBY_SYSTEMS_MOVEMENT_SYSTEM_HPP_
 
+#include "../common/globals.hpp"
 #include "../components/rigidbody_component.hpp"
 #include "../components/transform_component.hpp"
 #include "../ecs/ecs.hpp"
+#include "../jobs/jobs.hpp"
 
 namespace debby {
 
@@ -15,19 +17,30 @@ namespace debby {
 class MovementSystem : public ecs::System {
    public:
     MovementSystem() {
-        require_component<TransformComponent>();
-        require_component<RigidBodyComponent>();
+        require_component<TransformComponent>(ecs::Access::write);
+        require_component<RigidBodyComponent>(ecs::Access::read);
+        access_resource<GameContext>(ecs::Access::read);
     }
 
-    inline void update(float dt) {
-        for (auto entity : get_entities()) {
-            auto &transform{entity.get_component<TransformComponent>()};
-            const auto &rigid_body{entity.get_component<RigidBodyComponent>()};
-
-            transform.position += (rigid_body.velocity * dt);
-        }
+    inline void update(float) override {
+        const float delta_time{registry->resource<GameContext>().delta_time};
+        jobs::parallel_for(
+            registry->view<TransformComponent, RigidBodyComponent>(),
+            constants::JOB_CHUNK_SIZE,
+            [this, delta_time](ecs::Entity entity,
+                               TransformComponent &transform,
+                               const RigidBodyComponent &rigid_body) {
+                /* static entities keep their change tick */
+                if (rigid_body.velocity == glm::vec2{0, 0}) {
+                    return;
+                }
+                transform.position += (rigid_body.velocity * delta_time);
+                registry->mark_changed<TransformComponent>(entity);
+            });
     }
 };
+
+DEBBY_ECS_SYSTEM(MovementSystem, 0)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_MOVEMENT_SYSTEM_HPP_
@@ -6,9 +6,14 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "../components/sprite_component.hpp"
 #include "../components/transform_component.hpp"
+#include "../components/worldtransform_component.hpp"
 #include "../ecs/ecs.hpp"
 #include "../managers/asset_manager.hpp"
 #include "../managers/screen_manager.hpp"
@@ -19,35 +24,213 @@ namespace debby {
  *
  * Entities must have the following components:
  * - TransformComponent
- * - SpriteComponent */
+ * - SpriteComponent
+ *
+ * The WorldTransformComponent is used instead of the
+ * TransformComponent for entities that have one. The draw order is
+ * only updated for sprites whose change tick says so, so a z_index
+ * must be changed through Registry::mark_changed */
 class RenderSystem : public ecs::System {
    private:
+    /* The z_index is copied from the sprite, such that
+     * the order can be checked without looking it up */
+    struct Drawable {
+        ecs::Id entity_id;
+        int z_index;
+    };
+
+    /* Above this many new or relisted entities, the draw list is
+     * radix sorted instead of fixed one entity at a time */
+    static constexpr std::size_t MAX_LOCAL_FIXES{32};
+
     SDL_Renderer *_renderer = managers::screen::get_renderer();
 
+    /* Entities sorted by z_index, kept between frames such that frames
+     * where nothing changed order do no sorting. Entities with the same
+     * z_index are drawn in the order they were listed under it */
+    std::vector<Drawable> _draw_list;
+
+    /* Entity id and z_index in the draw list per
+     * entity index, the id is INVALID_ID if not listed */
+    std::vector<ecs::Id> _listed;
+    std::vector<int> _listed_z;
+
+    /* Membership version the draw list was last brought up to date with */
+    std::size_t _synced_version = 0;
+
+    /* kept between frames to avoid reallocating each update */
+    std::vector<Drawable> _pending;
+    std::vector<Drawable> _sort_buffer;
+    std::vector<ecs::Id> _changed;
+
+    [[nodiscard]] static inline std::uint32_t _radix_key(
+        const Drawable &drawable) {
+        /* flipping the sign bit orders negative values first */
+        return static_cast<std::uint32_t>(drawable.z_index) ^ 0x80000000u;
+    }
+
+    /* Stable LSD radix sort with a byte per pass. Passes where every
+     * key has the same byte are skipped, such that the usual small
+     * range of z_index values costs a single pass */
+    inline void _radix_sort() {
+        if (_draw_list.empty()) {
+            return;
+        }
+        _sort_buffer.resize(_draw_list.size());
+        for (unsigned int shift = 0; shift < 32; shift += 8) {
+            std::array<std::size_t, 256> offsets{};
+            for (const Drawable &drawable : _draw_list) {
+                offsets[(_radix_key(drawable) >> shift) & 0xFF]++;
+            }
+            if (offsets[(_radix_key(_draw_list.front()) >> shift) & 0xFF] ==
+                _draw_list.size()) {
+                continue;
+            }
+            std::size_t total{0};
+            for (std::size_t &offset : offsets) {
+                const std::size_t count{offset};
+                offset = total;
+                total += count;
+            }
+            for (const Drawable &drawable : _draw_list) {
+                _sort_buffer[offsets[(_radix_key(drawable) >> shift) &
+                                     0xFF]++] = drawable;
+            }
+            _draw_list.swap(_sort_buffer);
+        }
+    }
+
+    /* Lists an entity, or lists it again under a new z_index, in which
+     * case the entry under the old one is dropped by _drop_unlisted */
+    inline void _list(ecs::Id entity_id, int z_index) {
+        const ecs::Id index{ecs::entity_index(entity_id)};
+        if (index >= _listed.size()) {
+            _listed.resize(index + 1, ecs::INVALID_ID);
+            _listed_z.resize(index + 1, 0);
+        }
+        _listed[index] = entity_id;
+        _listed_z[index] = z_index;
+        _pending.push_back({entity_id, z_index});
+    }
+
+    /* Drops entries of entities that left the system, when is_left
+     * is set, and of entities listed again since the entry was made */
+    inline void _drop_unlisted(bool is_left) {
+        std::size_t kept{0};
+        for (const Drawable &drawable : _draw_list) {
+            const ecs::Entity entity{drawable.entity_id};
+            const ecs::Id index{entity.get_index()};
+            if (is_left && _listed[index] == drawable.entity_id &&
+                !has_entity(entity)) {
+                _listed[index] = ecs::INVALID_ID;
+            }
+            if (_listed[index] != drawable.entity_id ||
+                _listed_z[index] != drawable.z_index) {
+                continue;
+            }
+            _draw_list[kept++] = drawable;
+        }
+        _draw_list.resize(kept);
+    }
+
+    /* Picks up sprites added or changed since the last run, whose
+     * z_index is compared with the listed one, and entities that
+     * joined or left the system, which the membership version tells.
+     * Frames where neither happened touch no listed entity */
+    inline void _update_draw_list(const ecs::Pool<SpriteComponent> &sprites,
+                                  ecs::Tick since) {
+        _changed.clear();
+        sprites.collect_updated(since, _changed);
+        for (const ecs::Id entity_id : _changed) {
+            const ecs::Entity entity{entity_id};
+            const ecs::Id index{entity.get_index()};
+            if (!has_entity(entity)) {
+                continue;
+            }
+            const int z_index{sprites.get_item(entity_id).z_index};
+            if (index < _listed.size() && _listed[index] == entity_id &&
+                _listed_z[index] == z_index) {
+                continue;
+            }
+            _list(entity_id, z_index);
+        }
+
+        const bool is_synced{get_membership_version() == _synced_version};
+        if (!is_synced || !_pending.empty()) {
+            _drop_unlisted(!is_synced);
+        }
+        /* every listed entity is in the system, so equal sizes mean
+         * that none joined it. Those whose sprite was removed during
+         * the frame are listed once it is added again */
+        if (!is_synced && _draw_list.size() + _pending.size() !=
+                              get_entities().size()) {
+            for (const ecs::Entity entity : get_entities()) {
+                const ecs::Id index{entity.get_index()};
+                if ((index >= _listed.size() ||
+                     _listed[index] != entity.get_id()) &&
+                    sprites.contains(entity.get_id())) {
+                    _list(entity.get_id(),
+                          sprites.get_item(entity.get_id()).z_index);
+                }
+            }
+        }
+        _synced_version = get_membership_version();
+
+        if (_pending.size() > MAX_LOCAL_FIXES) {
+            _draw_list.insert(_draw_list.end(), _pending.begin(),
+                              _pending.end());
+            _radix_sort();
+        } else {
+            for (const Drawable &drawable : _pending) {
+                _draw_list.insert(
+                    std::upper_bound(_draw_list.begin(), _draw_list.end(),
+                                     drawable,
+                                     [](const Drawable &a, const Drawable &b) {
+                                         return a.z_index < b.z_index;
+                                     }),
+                    drawable);
+            }
+        }
+        _pending.clear();
+    }
+
    public:
     RenderSystem() {
-        require_component<TransformComponent>();
-        require_component<SpriteComponent>();
+        set_phase(ecs::Phase::render);
+        require_component<TransformComponent>(ecs::Access::read);
+        require_component<SpriteComponent>(ecs::Access::read);
+        access_component<WorldTransformComponent>(ecs::Access::read);
     }
 
-    inline void update() {
-        // TODO should probably not sort on each frame
-        auto entities{get_entities()};
-        std::sort(entities.begin(), entities.end(),
-                  [&](const ecs::Entity a, const ecs::Entity b) {
-                      return a.get_component<SpriteComponent>().z_index <
-                             b.get_component<SpriteComponent>().z_index;
-                  });
-        for (auto entity : entities) {
-            const auto &sprite{entity.get_component<SpriteComponent>()};
+    inline void update(float delta_time) override {
+        const ecs::Tick since{begin_run()};
+        const auto *sprites{registry->get_pool<SpriteComponent>()};
+        const auto *transforms{registry->get_pool<TransformComponent>()};
+        if (!sprites || !transforms) {
+            return;
+        }
+        _update_draw_list(*sprites, since);
+        const auto *worlds{registry->get_pool<WorldTransformComponent>()};
+        for (const Drawable &drawable : _draw_list) {
+            /* components removed during the frame only take
+             * entities out of the system on the next update */
+            if (!sprites->contains(drawable.entity_id) ||
+                !transforms->contains(drawable.entity_id)) {
+                continue;
+            }
+            const auto &sprite{sprites->get_item(drawable.entity_id)};
             const auto &texture{managers::asset::get_texture(sprite.asset_id)};
             if (!texture) {
                 // TODO can probably check if a texture exists earlier on
                 spdlog::warn("texture {0} not found on entity {1:d}",
-                             sprite.asset_id, entity.get_id());
+                             sprite.asset_id,
+                             ecs::entity_index(drawable.entity_id));
                 continue;
             }
-            const auto &transform{entity.get_component<TransformComponent>()};
+            const auto &transform{
+                worlds && worlds->contains(drawable.entity_id)
+                    ? worlds->get_item(drawable.entity_id)
+                    : transforms->get_item(drawable.entity_id)};
 
             SDL_Rect src_rect{sprite.get_rect()};
             SDL_Rect dst_rect{
@@ -61,6 +244,8 @@ class RenderSystem : public ecs::System {
         }
     }
 };
+
+DEBBY_ECS_SYSTEM(RenderSystem, 1)
 }  // namespace debby
 
 #endif  // DEBBY_SYSTEMS_RENDER_SYSTEM_HPP_